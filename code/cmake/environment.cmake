@@ -72,15 +72,28 @@ set (CMAKE_CXX_FLAGS_DEBUG "${CMAKE_CXX_FLAGS_DEBUG} -g3 -O0")
 set (CMAKE_CXX_FLAGS_RELEASE "${CMAKE_CXX_FLAGS_RELEASE} -O3")
 
 
-# check for -std=c++14
+# check for -std=c++14 (or -std=c++20, enabling coroutine support, if requested)
+option(USE_CXX20 "Compile with -std=c++20, enabling coroutine tasks" OFF)
 include(CheckCXXCompilerFlag)
 check_cxx_compiler_flag( -std=c++14 CXX14_Support )
-if(CXX14_Support)
+check_cxx_compiler_flag( -std=c++20 CXX20_Support )
+if(USE_CXX20 AND CXX20_Support)
+	set (CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -std=c++20")
+elseif(CXX14_Support)
+	if(USE_CXX20)
+		message( "WARNING: --std=c++20 not supported by your compiler!" )
+	endif()
 	set (CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -std=c++14")
 else()
 	message( "WARNING: --std=c++14 not supported by your compiler!" )
 endif()
 
+# select the future/promise implementation of the runtime
+option(USE_INLINE_FUTURES "Store results inside futures instead of a shared state (see runtime.h)" OFF)
+if(USE_INLINE_FUTURES)
+	add_definitions( -DPAREC_INLINE_FUTURES )
+endif()
+
 # add GCC specific flags
 if (CMAKE_COMPILER_IS_GNUCXX)
 	
@@ -6,7 +6,9 @@
 #include <tuple>
 #include <type_traits>
 
+#include "parec/selection.h"
 #include "parec/utils/runtime/runtime.h"
+#include "parec/utils/runtime/coroutine.h"
 #include "parec/utils/functional_utils.h"
 #include "parec/utils/tuple_utils.h"
 #include "parec/utils/vector_utils.h"
@@ -30,49 +32,41 @@ namespace parec {
 			return pickRandom(others...);
 		}
 
-		template<unsigned L>
-		struct random_caller {
-
-			template<
-				typename Res,
-				typename ... Versions,
-				typename ... Args
-			>
-			Res callRandom(unsigned pos, const std::tuple<Versions...>& version, const Args& ... args) {
-				if (pos == L) return std::get<L>(version)(args...);
-				return random_caller<L-1>().template callRandom<Res>(pos,version,args...);
-			}
+		/**
+		 * Obtains the value of the result of a step case, which may be a plain value or a
+		 * handle on it (e.g. if the step case is a coroutine).
+		 */
+		template<typename T>
+		typename std::decay<T>::type unwrap(T&& value) {
+			return std::forward<T>(value);
+		}
 
-			template<
-				typename Res,
-				typename ... Versions,
-				typename ... Args
-			>
-			Res callRandom(const std::tuple<Versions...>& version, const Args& ... args) {
-				int index = rand(sizeof...(Versions));
-				return callRandom<Res>(index, version, args...);
-			}
+		template<typename T>
+		T unwrap(utils::runtime::Future<T>&& future) {
+			return future.extract();
+		}
 
-		};
+		template<typename T>
+		T unwrap(utils::runtime::Immediate<T>&& immediate) {
+			return immediate.extract();
+		}
 
-		template<>
-		struct random_caller<0> {
-			template<
-				typename Res,
-				typename ... Versions,
-				typename ... Args
-			>
-			Res callRandom(unsigned, const std::tuple<Versions...>& versions, const Args& ... args) {
-				return std::get<0>(versions)(args...);
+		/**
+		 * Calls the given operation, producing a result of type R, and unwraps its result.
+		 */
+		template<typename R>
+		struct unwrapping_caller {
+			template<typename Op>
+			auto operator()(const Op& op) const {
+				return unwrap(op());
 			}
+		};
 
-			template<
-				typename Res,
-				typename ... Versions,
-				typename ... Args
-			>
-			Res callRandom(const std::tuple<Versions...>& versions, const Args& ... args) {
-				return std::get<0>(versions)(args...);
+		template<>
+		struct unwrapping_caller<void> {
+			template<typename Op>
+			void operator()(const Op& op) const {
+				op();
 			}
 		};
 
@@ -104,41 +98,82 @@ namespace parec {
 		std::tuple<BaseCases...> base;
 		std::tuple<StepCases...> step;
 
+		// the selection of alternative versions, shared by all copies of this definition
+		detail::version_selector<sizeof...(BaseCases)> base_selector;
+		detail::version_selector<sizeof...(StepCases)> step_selector;
+
 		fun_def(
 			const BaseCaseTest& test,
 			const std::tuple<BaseCases...>& base,
 			const std::tuple<StepCases...>& step
 		) : bc_test(test), base(base), step(step) {}
 
+		/**
+		 * Determines how alternative versions of the base and step cases are chosen.
+		 */
+		void setSelectionPolicy(SelectionPolicy policy) {
+			if (auto tuner = base_selector.getTuner()) tuner->setPolicy(policy);
+			if (auto tuner = step_selector.getTuner()) tuner->setPolicy(policy);
+		}
+
+		/**
+		 * Obtains the tracker of the alternative base cases, null if there is only one.
+		 */
+		const VersionTuner* getBaseCaseTuner() const {
+			return base_selector.getTuner();
+		}
+
+		/**
+		 * Obtains the tracker of the alternative step cases, null if there is only one.
+		 */
+		const VersionTuner* getStepCaseTuner() const {
+			return step_selector.getTuner();
+		}
+
 		template<typename ... Funs>
 		utils::runtime::Immediate<O> sequentialCall(const I& in, const Funs& ... funs) const {
 			// check for the base case
 			if (bc_test(in)) {
-				return utils::runtime::evaluate([&]{ return detail::random_caller<sizeof...(BaseCases)-1>().template callRandom<O>(base, in); });
+				return utils::runtime::evaluate([&]{ return base_selector.template call<O>(base, in); });
 			}
 
 			// run sequential step case
+			using seq_res = decltype(std::get<0>(step)(in, funs.sequential_call()...));
 			return utils::runtime::evaluate([&]{
-				return detail::random_caller<sizeof...(StepCases)-1>().template callRandom<O>(step, in, funs.sequential_call()...);
+				return detail::unwrapping_caller<seq_res>()([&]{
+					return step_selector.template call<seq_res>(step, in, funs.sequential_call()...);
+				});
 			});
 		}
 
 
 		template<typename ... Funs>
-		utils::runtime::Future<O> parallelCall(const I& in, const Funs& ... funs) const {
+		utils::runtime::Future<O> parallelCall(utils::runtime::SpawnPolicy policy, const I& in, const Funs& ... funs) const {
 			// check for the base case
 			const auto& base = this->base;
-			if (bc_test(in)) return utils::runtime::spawn([=] {
-				return detail::random_caller<sizeof...(BaseCases)-1>().template callRandom<O>(base, in);
-			});
+			const auto* base_selector = &this->base_selector;
+			if (bc_test(in)) {
+				auto run = [=] {
+					return base_selector->template call<O>(base, in);
+				};
+				return utils::runtime::spawn(policy, run, run);
+			}
 
-			// run step case
+			// run step case -- step cases may return a future on their result (e.g. coroutines)
 			const auto& step = this->step;
+			const auto* step_selector = &this->step_selector;
+			using seq_res = decltype(std::get<0>(step)(in, funs.sequential_call()...));
+			using par_res = decltype(std::get<0>(step)(in, funs.parallel_call()...));
 			return utils::runtime::spawn(
+					policy,
 					// sequential version:
-					[=]() { return detail::random_caller<sizeof...(StepCases)-1>().template callRandom<O>(step, in, funs.sequential_call()...); },
-					// parallel version:
-					[=]() { return detail::random_caller<sizeof...(StepCases)-1>().template callRandom<O>(step, in, funs.parallel_call()...); }
+					[=]() {
+						return detail::unwrapping_caller<seq_res>()([&]{
+							return step_selector->template call<seq_res>(step, in, funs.sequential_call()...);
+						});
+					},
+					// parallel version, not timed since it includes spawning and waiting for sub-calls:
+					[=]() { return step_selector->template call_untimed<par_res>(step, in, funs.parallel_call()...); }
 			);
 		}
 
@@ -224,14 +259,18 @@ namespace parec {
 
 			callable(const rec_defs<Defs...>& defs) : defs(defs) {};
 
+			// the recursive calls only refer to the definitions, such that they may be kept by suspended step cases
+
 			auto sequential_call() const {
-				return [&](const I& in)->utils::runtime::Immediate<O> {
+				const auto& defs = this->defs;
+				return [&defs](const I& in)->utils::runtime::Immediate<O> {
 					return defs.template sequentialCall<i,O,I>(in);
 				};
 			}
 
 			auto parallel_call() const {
-				return [&](const I& in)->utils::runtime::Future<O> {
+				const auto& defs = this->defs;
+				return [&defs](const I& in)->utils::runtime::Future<O> {
 					return defs.template parallelCall<i,O,I>(in);
 				};
 			}
@@ -265,7 +304,7 @@ namespace parec {
 			}
 			template<typename O, typename F, typename I, typename D, typename ... Args>
 			utils::runtime::Future<O> parallelCall(const F& f, const I& i, const D& d, const Args& ... args) const {
-				return f.parallelCall(i,createCallable<0>(d),args...);
+				return f.parallelCall(d.getSpawnPolicy(),i,createCallable<0>(d),args...);
 			}
 		};
 
@@ -288,9 +327,20 @@ namespace parec {
 	template<typename ... Defs>
 	struct rec_defs : public std::tuple<Defs...> {
 
+		// the policy to be applied when spawning recursive calls
+		utils::runtime::SpawnPolicy policy = utils::runtime::SpawnPolicy::Eager;
+
 		template<typename ... Args>
 		rec_defs(const Args& ... args) : std::tuple<Defs...>(args...) {}
 
+		utils::runtime::SpawnPolicy getSpawnPolicy() const {
+			return policy;
+		}
+
+		void setSpawnPolicy(utils::runtime::SpawnPolicy p) {
+			policy = p;
+		}
+
 		template<
 			unsigned i,
 			typename O,
@@ -324,6 +374,22 @@ namespace parec {
 
 	// --- parec operator ---
 
+	using utils::runtime::SpawnPolicy;
+	using utils::runtime::CancellationToken;
+	using utils::runtime::CancellationScope;
+	using utils::runtime::isCancelled;
+	using utils::runtime::operation_cancelled;
+
+	/**
+	 * Creates a parallel entry point for the i-th function of the given definitions. The
+	 * spawn policy determines whether recursive calls eagerly create tasks or are only
+	 * split off on demand (see SpawnPolicy::Lazy).
+	 *
+	 * Each invocation forms a cancellation scope of its own: if one of the base or step
+	 * cases raises an exception, the pending operations of the same invocation are
+	 * abandoned and the exception is rethrown when retrieving the result. Futures of
+	 * abandoned operations throw operation_cancelled instead of yielding a value.
+	 */
 
 	template<
 		unsigned i = 0,
@@ -331,9 +397,13 @@ namespace parec {
 		typename I = typename type_at<i,type_list<Defs...>>::type::in_type,
 		typename O = typename type_at<i,type_list<Defs...>>::type::out_type
 	>
-	auto parec(const rec_defs<Defs...>& defs) {
+	auto parec(const rec_defs<Defs...>& defs, SpawnPolicy policy = SpawnPolicy::Eager) {
+		auto copy = defs;
+		copy.setSpawnPolicy(policy);
 		return [=](const I& in)->utils::runtime::Future<O> {
-			return defs.template parallelCall<i,O,I>(in);
+			auto token = CancellationToken::create();
+			CancellationScope scope(token);
+			return copy.template parallelCall<i,O,I>(in);
 		};
 	}
 
@@ -356,4 +426,20 @@ namespace parec {
 		return prec<0>(fun(t,b,s));
 	}
 
+
+	// --- labels ---
+
+	/**
+	 * Attaches a label to the tasks created through the given parallel entry point (e.g.
+	 * the result of prec), distinguishing them in task timelines. Labels are only
+	 * recorded if tracing is enabled (see PAREC_ENABLE_TRACING).
+	 */
+	template<typename Entry>
+	auto label(const char* name, const Entry& entry) {
+		return [=](const auto& in) {
+			utils::runtime::TraceLabel scope(name);
+			return entry(in);
+		};
+	}
+
 } // end namespace parec
@@ -1,6 +1,13 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <exception>
+#include <initializer_list>
 #include <utility>
+#include <vector>
+
+#include "parec/utils/runtime/runtime.h"
 
 namespace parec {
 
@@ -9,15 +16,215 @@ namespace parec {
 	 * algorithms on top of it. Later implementations will have to provide smarter solutions.
 	 */
 
+	namespace detail {
+
+		/**
+		 * Inspects the given boolean handles in the order of their completion until one of
+		 * them yields the decisive value. The result is the decisive value if it has been
+		 * encountered, its negation otherwise. Once decided, the given token is cancelled.
+		 * Before returning, all handles are waited for, since the computations behind them
+		 * may refer to data of the caller. A failing handle decides the outcome too; the
+		 * failure of any handle is rethrown, even if it is only observed after the decision.
+		 * Handles abandoned due to a cancellation are skipped; if they leave the outcome
+		 * open, operation_cancelled is thrown.
+		 */
+		template<typename ... Handles>
+		bool decide(bool decisive, utils::runtime::CancellationToken& token, Handles& ... handles) {
+			std::array<bool,sizeof...(Handles)> seen;
+			seen.fill(false);
+			std::size_t remaining = sizeof...(Handles);
+			bool decided = false;
+			bool cancelled = false;
+			std::exception_ptr error;
+
+			// inspects the outcome of a completed handle
+			auto inspect = [&](const auto& handle) {
+				try {
+					if (handle.get() == decisive) decided = true;
+				} catch (...) {
+					auto e = std::current_exception();
+					if (utils::runtime::isCancellation(e)) {
+						cancelled = true;
+					} else {
+						if (!error) error = e;
+						decided = true;
+					}
+				}
+			};
+
+			while(!decided && remaining > 0) {
+
+				// check all completed handles
+				std::size_t i = 0;
+				bool progress = false;
+				auto check = [&](const auto& handle) {
+					auto& cur = seen[i++];
+					if (decided || cur || !handle.isDone()) return;
+					cur = true;
+					progress = true;
+					--remaining;
+					inspect(handle);
+				};
+				(void)std::initializer_list<int>{ (check(handles), 0)... };
+
+				// if nothing happened, help out while waiting
+				if (!progress) utils::runtime::detail::help();
+			}
+
+			// abandon the remaining computations, but wait for them
+			if (decided) token.cancel();
+			(void)std::initializer_list<int>{ (handles.wait(), 0)... };
+
+			// failures of handles not inspected yet take priority over the decision
+			if (!error) {
+				std::size_t i = 0;
+				auto late = [&](const auto& handle) {
+					if (!seen[i++]) inspect(handle);
+				};
+				(void)std::initializer_list<int>{ (late(handles), 0)... };
+			}
+
+			if (error) std::rethrow_exception(error);
+			if (decided) return decisive;
+			if (cancelled) throw utils::runtime::operation_cancelled();
+			return !decisive;
+		}
+
+		/**
+		 * The shared state of an asynchronous decision on a list of boolean futures.
+		 */
+		class decider : public utils::runtime::Pooled {
+
+			bool decisive;
+
+			utils::runtime::CancellationToken token;
+
+			std::vector<utils::runtime::Future<bool>> futures;
+
+			utils::runtime::Promise<bool> promise;
+
+			std::atomic<bool> decided;
+
+			// set if some future has been abandoned, published by the pending counter
+			std::atomic<bool> cancelled;
+
+			std::atomic<std::size_t> pending;
+
+		public:
+
+			decider(bool decisive, const utils::runtime::CancellationToken& token, std::vector<utils::runtime::Future<bool>>&& futures)
+				: decisive(decisive), token(token), futures(std::move(futures)), decided(false), cancelled(false), pending(this->futures.size()) {}
+
+			utils::runtime::Future<bool> getFuture() {
+				return promise.getFuture();
+			}
+
+			void start() {
+				// the registration of the continuations may complete and release this object
+				auto n = futures.size();
+				for(std::size_t i=0; i<n; ++i) {
+					futures[i].onReady([this,i]() { done(i); });
+				}
+			}
+
+		private:
+
+			void done(std::size_t i) {
+				// the first decisive value or failure, or the last value decides; abandoned
+				// futures are skipped
+				bool isDecisive = false;
+				std::exception_ptr error;
+				try {
+					isDecisive = futures[i].get() == decisive;
+				} catch (...) {
+					error = std::current_exception();
+					if (utils::runtime::isCancellation(error)) {
+						error = nullptr;
+						cancelled.store(true, std::memory_order_relaxed);
+					}
+				}
+				bool isLast = pending.fetch_sub(1, std::memory_order_acq_rel) == 1;
+				if ((isDecisive || error || isLast) && !decided.exchange(true)) {
+					if (error) {
+						promise.setException(error);
+					} else if (isDecisive) {
+						promise.set(decisive);
+					} else if (cancelled.load(std::memory_order_relaxed)) {
+						// the outcome is left open by the abandoned futures
+						promise.setException(std::make_exception_ptr(utils::runtime::operation_cancelled()));
+					} else {
+						promise.set(!decisive);
+					}
+					if (isDecisive || error) token.cancel();
+				}
+				if (isLast) delete this;
+			}
+
+		};
+
+		inline utils::runtime::Future<bool> decide_async(bool decisive, const utils::runtime::CancellationToken& token, std::vector<utils::runtime::Future<bool>>&& futures) {
+			if (futures.empty()) return !decisive;
+			auto state = new decider(decisive, token, std::move(futures));
+			auto res = state->getFuture();
+			state->start();
+			return res;
+		}
+
+		template<typename ... Handles>
+		utils::runtime::Future<bool> decide_async(bool decisive, const utils::runtime::CancellationToken& token, utils::runtime::Future<bool>&& first, Handles&& ... rest) {
+			std::vector<utils::runtime::Future<bool>> futures;
+			futures.push_back(std::move(first));
+			(void)std::initializer_list<int>{ (futures.push_back(std::move(rest)), 0)... };
+			return decide_async(decisive, token, std::move(futures));
+		}
+
+		template<typename ... Handles>
+		utils::runtime::Immediate<bool> decide_async(bool decisive, const utils::runtime::CancellationToken& token, utils::runtime::Immediate<bool>&& first, Handles&& ... rest) {
+			auto copy = token;
+			return decide(decisive, copy, first, rest...);
+		}
+
+	}
+
 	// ----- an all operator ----
 
 	inline bool all() { return true; }
 
+	/**
+	 * Determines whether all the given handles yield true. Handles are inspected in the
+	 * order of their completion, the outcome is decided by the first false value.
+	 */
 	template<template<typename> class Handle, typename ... Rest>
 	bool all(Handle<bool>&& a, Rest&& ... rest) {
-		// TODO: test futures => check them as soon as they are done, not in order
-		// TODO: return future instead of boolean
-		return a.get() && all(std::forward<Rest>(rest)...);
+		utils::runtime::CancellationToken none;
+		return detail::decide(false, none, a, rest...);
+	}
+
+	/**
+	 * Like all, but cancels the given token once the outcome is decided. Handles created
+	 * within a scope of the token (see CancellationScope) are thereby abandoned.
+	 */
+	template<template<typename> class Handle, typename ... Rest>
+	bool all(utils::runtime::CancellationToken token, Handle<bool>&& a, Rest&& ... rest) {
+		return detail::decide(false, token, a, rest...);
+	}
+
+	/**
+	 * An asynchronous version of all. The resulting future is ready as soon as the outcome
+	 * is decided, even if some of the given computations are still running. Thus, those
+	 * must not refer to any data that may be gone before their completion.
+	 */
+	template<template<typename> class Handle, typename ... Rest>
+	Handle<bool> all_async(Handle<bool>&& a, Rest&& ... rest) {
+		return detail::decide_async(false, utils::runtime::CancellationToken(), std::move(a), std::forward<Rest>(rest)...);
+	}
+
+	/**
+	 * Like all_async, but cancels the given token once the outcome is decided.
+	 */
+	template<template<typename> class Handle, typename ... Rest>
+	Handle<bool> all_async(const utils::runtime::CancellationToken& token, Handle<bool>&& a, Rest&& ... rest) {
+		return detail::decide_async(false, token, std::move(a), std::forward<Rest>(rest)...);
 	}
 
 
@@ -25,11 +232,38 @@ namespace parec {
 
 	inline bool any() { return false; }
 
+	/**
+	 * Determines whether any of the given handles yields true. Handles are inspected in the
+	 * order of their completion, the outcome is decided by the first true value.
+	 */
 	template<template<typename> class Handle, typename ... Rest>
 	bool any(Handle<bool>&& a, Rest&& ... rest) {
-		// TODO: test futures => check them as soon as they are done, not in order
-		// TODO: return future instead of boolean
-		return a.get() || any(std::forward<Rest>(rest)...);
+		utils::runtime::CancellationToken none;
+		return detail::decide(true, none, a, rest...);
+	}
+
+	/**
+	 * Like any, but cancels the given token once the outcome is decided.
+	 */
+	template<template<typename> class Handle, typename ... Rest>
+	bool any(utils::runtime::CancellationToken token, Handle<bool>&& a, Rest&& ... rest) {
+		return detail::decide(true, token, a, rest...);
+	}
+
+	/**
+	 * An asynchronous version of any, subject to the same restrictions as all_async.
+	 */
+	template<template<typename> class Handle, typename ... Rest>
+	Handle<bool> any_async(Handle<bool>&& a, Rest&& ... rest) {
+		return detail::decide_async(true, utils::runtime::CancellationToken(), std::move(a), std::forward<Rest>(rest)...);
+	}
+
+	/**
+	 * Like any_async, but cancels the given token once the outcome is decided.
+	 */
+	template<template<typename> class Handle, typename ... Rest>
+	Handle<bool> any_async(const utils::runtime::CancellationToken& token, Handle<bool>&& a, Rest&& ... rest) {
+		return detail::decide_async(true, token, std::move(a), std::forward<Rest>(rest)...);
 	}
 
 
@@ -39,9 +273,33 @@ namespace parec {
 
 	template<template<typename> class Handle, typename First, typename ... Rest>
 	void parallel(Handle<First>&& f, Rest&& ... rest) {
+		// all operations are completed before a failure is reported
+		(void)std::initializer_list<int>{ (f.wait(), 0), (rest.wait(), 0)... };
 		f.get();
 		parallel(std::forward<Rest>(rest)...);
 	}
 
+	inline void parallel_invoke() { }
+
+	/**
+	 * Runs the given operations as sibling tasks of a task group and waits for all of
+	 * them; the last operation is processed by the calling thread. The first failure is
+	 * rethrown, it abandons the operations not started yet.
+	 */
+	template<typename First, typename ... Rest>
+	void parallel_invoke(const First& first, const Rest& ... rest) {
+		utils::runtime::TaskGroup group;
+		std::size_t i = 0;
+		auto run = [&](const auto& op) {
+			if (++i < 1 + sizeof...(Rest)) {
+				group.run([&op]() { op(); });
+			} else {
+				group.runAndWait(op);
+			}
+		};
+		run(first);
+		(void)std::initializer_list<int>{ (run(rest), 0)... };
+	}
+
 
 } // end namespace parec
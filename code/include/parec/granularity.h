@@ -0,0 +1,151 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+#include "parec/utils/runtime/runtime.h"
+
+namespace parec {
+
+	/**
+	 * Determines the number of elements the leaves of a recursively split loop should
+	 * cover. The controller measures the execution time of leaves and estimates the cost
+	 * per element, such that leaves take about the targeted time. The estimate learned by
+	 * one invocation of a loop is used by the following ones sharing its controller.
+	 *
+	 * Loops may be handed a controller of their own (see the loop operators in ops.h).
+	 * Otherwise, they share the controller of their type of range and body, which for
+	 * lambdas corresponds to the call site, but is shared among all loops running the
+	 * same function (e.g. a function pointer or std::function) over the same range type.
+	 *
+	 * Until the first leaf has been measured, loops are split into about 1000 leaves.
+	 * Independent of the cost, loops are split into at least 4 leaves per thread, as long
+	 * as there are enough elements.
+	 */
+	class GranularityController {
+
+	public:
+
+		// the weight of a new measurement in the estimated cost per element
+		static constexpr double weight = 0.25;
+
+		// the number of leaves per thread loops are split into at least
+		static const std::size_t min_leaves_per_thread = 4;
+
+		/**
+		 * The cutoff of one invocation of a loop, adapted while the loop is processed.
+		 */
+		class Cutoff {
+
+			const GranularityController& controller;
+
+			// the cutoff until the cost is known
+			std::size_t initial;
+
+			// the upper limit of the cutoff, preserving some parallel slack
+			std::size_t limit;
+
+		public:
+
+			Cutoff(const GranularityController& controller, std::size_t initial, std::size_t limit)
+				: controller(controller), initial(initial), limit(limit) {}
+
+			/**
+			 * Obtains the number of elements to be processed by leaves of the loop.
+			 */
+			std::size_t operator()() const {
+				double cost = controller.getElementCost();
+				std::size_t res = (cost > 0) ? std::size_t(controller.target.count() / cost) : initial;
+				return std::max<std::size_t>(1, std::min(res, limit));
+			}
+
+		};
+
+		/**
+		 * Measures the time of a leaf from its creation to its destruction.
+		 */
+		class LeafTimer {
+
+			GranularityController& controller;
+
+			std::size_t elements;
+
+			std::chrono::steady_clock::time_point begin;
+
+		public:
+
+			LeafTimer(GranularityController& controller, std::size_t elements)
+				: controller(controller), elements(elements), begin(std::chrono::steady_clock::now()) {}
+
+			LeafTimer(const LeafTimer&) = delete;
+
+			LeafTimer& operator=(const LeafTimer&) = delete;
+
+			~LeafTimer() {
+				controller.record(elements, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin));
+			}
+
+		};
+
+	private:
+
+		// the targeted time of a leaf
+		std::chrono::nanoseconds target;
+
+		// the estimated cost per element in nanoseconds, 0 if unknown
+		std::atomic<double> cost;
+
+	public:
+
+		explicit GranularityController(std::chrono::nanoseconds target = std::chrono::microseconds(50))
+			: target(target), cost(0) {}
+
+		std::chrono::nanoseconds getTarget() const {
+			return target;
+		}
+
+		/**
+		 * Obtains the estimated cost per element in nanoseconds, 0 if not known yet.
+		 */
+		double getElementCost() const {
+			return cost.load(std::memory_order_relaxed);
+		}
+
+		/**
+		 * Obtains the cutoff for a loop over the given number of elements.
+		 */
+		Cutoff getCutoff(std::size_t elements) const {
+			std::size_t threads = utils::runtime::WorkerPool::getCurrent().getNumWorkers() + 1;
+			return Cutoff(*this, elements / 1000, elements / (min_leaves_per_thread * threads));
+		}
+
+		/**
+		 * Records the time taken by a leaf processing the given number of elements.
+		 * Concurrent updates may get lost, which only delays the adaptation.
+		 */
+		void record(std::size_t elements, std::chrono::nanoseconds time) {
+			if (elements == 0) return;
+			double sample = double(time.count()) / elements;
+			double old = cost.load(std::memory_order_relaxed);
+			cost.store((old > 0) ? old + (sample - old) * weight : sample, std::memory_order_relaxed);
+		}
+
+	};
+
+	namespace detail {
+
+		/**
+		 * Obtains the controller shared by loops without a controller of their own,
+		 * one per combination of the given types.
+		 */
+		template<typename ... Key>
+		GranularityController& getSharedGranularity() {
+			static GranularityController granularity;
+			return granularity;
+		}
+
+	}
+
+} // end namespace parec
@@ -8,6 +8,7 @@
 
 #include "parec/core.h"
 #include "parec/async.h"
+#include "parec/granularity.h"
 #include "parec/utils/sequence.h"
 
 namespace parec {
@@ -92,20 +93,21 @@ namespace parec {
 		struct binary_split {
 
 			/**
-			 * The implementation for standard 1D iterators.
+			 * The implementation for standard 1D iterators, choosing the size of leaves by
+			 * the given controller.
 			 */
 			template<typename Iter, typename Op>
-			void operator()(Iter a, Iter b, const Op& op) {
+			void operator()(Iter a, Iter b, const Op& op, GranularityController& granularity = detail::getSharedGranularity<Iter,Op>()) {
 				// implements a binary splitting policy for iterating over the given iterator range
-				auto cut = detail::distance(a,b) / 1000; // hardcoded cutoff, to be removed when runtime is smart enough to find good value
-				cut = (cut < 1) ? 1 : cut;
+				auto cut = granularity.getCutoff(detail::distance(a,b));
 				typedef std::pair<Iter,Iter> range;
-				prec(
+				label("pfor", prec(
 					[cut](const range& r) {
-						return detail::distance(r.first,r.second) <= cut;
+						return detail::distance(r.first,r.second) <= cut();
 					},
 					[&](const range& r) {
 						if (detail::distance(r.first,r.second) < 1) return;
+						GranularityController::LeafTimer timer(granularity, detail::distance(r.first,r.second));
 						for(auto it = r.first; it != r.second; ++it) op(detail::access(it));
 					},
 					[](const range& r, const auto& f) {
@@ -115,14 +117,15 @@ namespace parec {
 						auto b = f(range(mid, r.second));
 						a.get(); b.get();		// sync futures (also automated by destructor)
 					}
-				)(range(a,b)).get();
+				))(range(a,b)).get();
 			}
 
 			/**
-			 * The implementation for higher-dimensions iterators.
+			 * The implementation for higher-dimensions iterators, choosing the size of leaves
+			 * by the given controller.
 			 */
 			template<typename Iter, size_t dims, typename Op>
-			void operator()(const std::array<Iter,dims>& a, const std::array<Iter,dims>& b, const Op& op) {
+			void operator()(const std::array<Iter,dims>& a, const std::array<Iter,dims>& b, const Op& op, GranularityController& granularity = detail::getSharedGranularity<std::array<Iter,dims>,Op>()) {
 				// process 0-dimensional case
 				if (dims == 0) return; // no iterations required
 
@@ -132,14 +135,14 @@ namespace parec {
 				for(size_t i = 0; i<dims; i++) {
 					full[i] = std::make_pair(a[i],b[i]);
 				}
-				auto cut = detail::area(full) / 1000;
-				cut = (cut < 1) ? 1 : cut;
-				prec(
+				auto cut = granularity.getCutoff(detail::area(full));
+				label("pfor", prec(
 					[cut](const range& r) {
-						return detail::area(r) <= cut;
+						return detail::area(r) <= cut();
 					},
 					[&](const range& r) {
 						if (detail::area(r) < 1) return;
+						GranularityController::LeafTimer timer(granularity, detail::area(r));
 						detail::for_each(r,op);
 					},
 					[](const range& r, const auto& f) {
@@ -171,7 +174,7 @@ namespace parec {
 						auto y = f(b);
 						x.get(); y.get();		// sync futures (also automated by destructor)
 					}
-				)(full).get();
+				))(full).get();
 			}
 
 		};
@@ -188,19 +191,11 @@ namespace parec {
 			 */
 			template<typename Iter, typename Op>
 			void operator()(Iter a, Iter b, const Op& op) {
-				// implementation of a worker-queue for the range to be iterated over
-				std::vector<utils::runtime::Future<void>> futures;
-				futures.reserve(detail::distance(a,b));
-				// spawn tasks
-				for(Iter i = a; i < b; ++i) {
-					futures.push_back(async([i,&op](){
-						op(detail::access(i));
-					}));
-				}
-				// wait for tasks
-				for(const auto& cur : futures) {
-					cur.get();
-				}
+				// implementation of a worker-queue for the range to be iterated over, spawning
+				// one task per element in a single batch
+				utils::runtime::spawn_n(detail::distance(a,b), [a,&op](std::size_t i) {
+					op(detail::access(a + i));
+				}).get();
 			}
 
 			/**
@@ -220,19 +215,17 @@ namespace parec {
 					full[i] = std::make_pair(a[i],b[i]);
 				}
 
-				// spawn all tasks
-				std::vector<utils::runtime::Future<void>> futures;
-				futures.reserve(detail::area(full));
+				// enumerate all positions
+				std::vector<std::array<Iter,dims>> positions;
+				positions.reserve(detail::area(full));
 				detail::for_each(full,[&](const auto& pos) {
-					futures.push_back(async([pos,&op](){
-						op(pos);
-					}));
+					positions.push_back(pos);
 				});
 
-				// wait for all tasks to finish
-				for(const auto& cur : futures) {
-					cur.get();
-				}
+				// spawn all tasks in a single batch and wait for them to finish
+				utils::runtime::spawn_n(positions.size(), [&](std::size_t i) {
+					op(positions[i]);
+				}).get();
 			}
 
 		};
@@ -271,6 +264,43 @@ namespace parec {
 		pfor<policy>(c.begin(), c.end(), op);
 	}
 
+	/**
+	 * A parallel for-each implementation over the given range, splitting it by the binary split
+	 * policy into leaves sized by the given controller. The controller must outlive the loop and
+	 * may be shared with other loops of similar cost per element.
+	 */
+	template<typename Iter, size_t dims, typename Op>
+	void pfor(const std::array<Iter,dims>& a, const std::array<Iter,dims>& b, const Op& op, GranularityController& granularity) {
+		loop_policy::binary_split()(a,b,op,granularity);
+	}
+
+	/**
+	 * A parallel for-each implementation iterating over the given range of elements, using
+	 * the given controller for sizing the leaves of the binary split policy.
+	 */
+	template<typename Iter, typename Op>
+	void pfor(Iter a, Iter b, const Op& op, GranularityController& granularity) {
+		loop_policy::binary_split()(a,b,op,granularity);
+	}
+
+	/**
+	 * A parallel for-each implementation iterating over the elements of the given container,
+	 * using the given controller for sizing the leaves of the binary split policy.
+	 */
+	template<typename Container, typename Op>
+	void pfor(Container& c, const Op& op, GranularityController& granularity) {
+		pfor(c.begin(), c.end(), op, granularity);
+	}
+
+	/**
+	 * A parallel for-each implementation iterating over the elements of the given container,
+	 * using the given controller for sizing the leaves of the binary split policy.
+	 */
+	template<typename Container, typename Op>
+	void pfor(const Container& c, const Op& op, GranularityController& granularity) {
+		pfor(c.begin(), c.end(), op, granularity);
+	}
+
 	// ----- reduction ------
 
 	template<typename Iter, typename Op>
@@ -280,7 +310,7 @@ namespace parec {
 
 		// implements a binary splitting policy for iterating over the given iterator range
 		typedef std::pair<Iter,Iter> range;
-		return prec(
+		return label("preduce", prec(
 			[](const range& r) {
 				return std::distance(r.first,r.second) <= 1;
 			},
@@ -295,7 +325,7 @@ namespace parec {
 				auto b = f(range(mid, r.second));
 				return op(a.get(), b.get());
 			}
-		)(range(a,b)).get();
+		))(range(a,b)).extract();
 	}
 
 	/**
@@ -334,7 +364,8 @@ namespace parec {
 			const MapOp& map,
 			const ReduceOp& reduce,
 			const InitLocalState& init,
-			const ReduceLocalState& exit = [](typename lambda_traits<ReduceOp>::result_type r) { return r; } -> lambda_traits<ReduceOp>::result_type
+			const ReduceLocalState& exit = [](typename lambda_traits<ReduceOp>::result_type r) { return r; } -> lambda_traits<ReduceOp>::result_type,
+			GranularityController& granularity = detail::getSharedGranularity<std::array<Iter,dims>,MapOp,ReduceOp,InitLocalState,ReduceLocalState>()
 			) {
 
 		using res_type = typename lambda_traits<ReduceOp>::result_type;
@@ -345,16 +376,16 @@ namespace parec {
 			full[i] = std::make_pair(a[i],b[i]);
 		}
 
-		auto cut = detail::area(full) / 1000;
-		cut = (cut < 1) ? 1 : cut;
+		auto cut = granularity.getCutoff(detail::area(full));
 
-		return prec(
+		return label("map_reduce", prec(
 			[&](const range& r) {
-			return detail::area(r) <= cut;
+				return detail::area(r) <= cut();
 			},
 			[&](const range& r)->res_type {
 				auto res = init();
 				if (detail::area(r) < 1) return res;
+				GranularityController::LeafTimer timer(granularity, detail::area(r));
 
 				auto mapB = [map,&res](const std::array<Iter,dims>& cur) {
 					return map(cur,res);
@@ -362,7 +393,7 @@ namespace parec {
 
 				detail::for_each(r,mapB);
 
-				return exit(res);
+				return exit(std::move(res));
 			},
 			[&](const range& r, const auto& f)->res_type {
 				// here we have the binary splitting
@@ -395,7 +426,7 @@ namespace parec {
 
 				return reduce(std::move(x.extract()), std::move(y.extract()));
 			}
-		)(full).get();
+		))(full).extract();
 
 		return res_type();
 
@@ -416,7 +447,8 @@ namespace parec {
 			const MapOp& map,
 			const ReduceOp& reduce,
 			const InitLocalState& init,
-			const ReduceLocalState& exit = [](typename lambda_traits<ReduceOp>::result_type r) { return r; } -> lambda_traits<ReduceOp>::result_type
+			const ReduceLocalState& exit = [](typename lambda_traits<ReduceOp>::result_type r) { return r; } -> lambda_traits<ReduceOp>::result_type,
+			GranularityController& granularity = detail::getSharedGranularity<Iter,MapOp,ReduceOp,InitLocalState,ReduceLocalState>()
 		) {
 
 		using res_type = typename lambda_traits<ReduceOp>::result_type;
@@ -424,19 +456,19 @@ namespace parec {
 		typedef std::pair<Iter, Iter> range;
 		auto full = range(a, b);
 
-		unsigned cut = detail::distance(full.first,full.second) / 1000;
-		cut = (cut < 1) ? 1 : cut;
+		auto cut = granularity.getCutoff(detail::distance(full.first,full.second));
 
-		return prec(
+		return label("map_reduce", prec(
 			[&](const range& r) {
-				return std::distance(r.first,r.second) <= cut;
+				return detail::distance(r.first,r.second) <= cut();
 			},
 			[&](const range& r)->res_type {
 				auto res = init();
+				GranularityController::LeafTimer timer(granularity, detail::distance(r.first,r.second));
 				for(auto it = r.first; it != r.second; ++it) {
 					map(*it,res);
 				}
-				return exit(res);
+				return exit(std::move(res));
 			},
 			[&](const range& r, const auto& f)->res_type {
 				// here we have the binary splitting
@@ -445,7 +477,7 @@ namespace parec {
 				auto b = f(range(mid, r.second));
 				return reduce(std::move(a.extract()), std::move(b.extract()));
 			}
-		)(full).get();
+		))(full).extract();
 
 
 		return typename lambda_traits<ReduceOp>::result_type();
@@ -465,10 +497,11 @@ namespace parec {
 			const MapOp& map,
 			const ReduceOp& reduce,
 			const InitLocalState& init,
-			const ReduceLocalState& exit = [](Container r) { return r; } -> Container
+			const ReduceLocalState& exit = [](Container r) { return r; } -> Container,
+			GranularityController& granularity = detail::getSharedGranularity<Container,MapOp,ReduceOp,InitLocalState,ReduceLocalState>()
 		) {
 
-		return map_reduce(c.begin(), c.end(), map, reduce, init, exit);
+		return map_reduce(c.begin(), c.end(), map, reduce, init, exit, granularity);
 
 	}
 
@@ -0,0 +1,420 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace parec {
+
+	/**
+	 * The policies for choosing among the alternative versions of base and step cases
+	 * offered through pick:
+	 *
+	 *  - Random:     versions are chosen uniformly at random
+	 *  - RoundRobin: versions are chosen in turn
+	 *  - Autotune:   the execution times of the versions are measured online, grouped by
+	 *                the size of the input, and the fastest version is chosen; step cases
+	 *                are only measured when processed sequentially
+	 *
+	 * The default policy is Autotune; it may be changed through the environment variable
+	 * SELECTION_POLICY (random, round_robin or autotune).
+	 */
+	enum class SelectionPolicy {
+		Random, RoundRobin, Autotune
+	};
+
+	inline std::ostream& operator<<(std::ostream& out, SelectionPolicy policy) {
+		switch(policy) {
+			case SelectionPolicy::Random: return out << "random";
+			case SelectionPolicy::RoundRobin: return out << "round_robin";
+			case SelectionPolicy::Autotune: return out << "autotune";
+		}
+		return out << "unknown";
+	}
+
+	/**
+	 * Obtains the selection policy of new definitions.
+	 */
+	inline SelectionPolicy getDefaultSelectionPolicy() {
+		static const SelectionPolicy policy = []() {
+			if (char* val = std::getenv("SELECTION_POLICY")) {
+				std::string name = val;
+				if (name == "random") return SelectionPolicy::Random;
+				if (name == "round_robin") return SelectionPolicy::RoundRobin;
+			}
+			return SelectionPolicy::Autotune;
+		}();
+		return policy;
+	}
+
+	namespace detail {
+
+		/**
+		 * A pseudo random number generator (xorshift) with a state per thread. Unlike
+		 * std::rand, it is not serialized among threads.
+		 */
+		inline std::uint32_t fastRand() {
+			thread_local std::uint32_t state = std::uint32_t(std::hash<std::thread::id>()(std::this_thread::get_id())) | 1;
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return state;
+		}
+
+		/**
+		 * Determines the size of the input of a base or step case for grouping the
+		 * measurements of the autotuner: the value of numbers, the length of ranges
+		 * and the size of containers. Other inputs have size 0.
+		 */
+		template<typename T>
+		typename std::enable_if<std::is_arithmetic<T>::value,std::size_t>::type
+		input_size(const T& in, int) {
+			return (in > 0) ? std::size_t(in) : 0;
+		}
+
+		template<typename T>
+		typename std::enable_if<std::is_arithmetic<T>::value,std::size_t>::type
+		input_size(const std::pair<T,T>& in, int) {
+			return (in.second > in.first) ? std::size_t(in.second - in.first) : 0;
+		}
+
+		template<typename Iter>
+		auto input_size(const std::pair<Iter,Iter>& in, int) -> decltype(std::size_t(std::distance(in.first,in.second))) {
+			return std::distance(in.first,in.second);
+		}
+
+		template<typename T>
+		auto input_size(const T& in, int) -> decltype(std::size_t(in.size())) {
+			return in.size();
+		}
+
+		template<typename T>
+		std::size_t input_size(const T&, long) {
+			return 0;
+		}
+
+		template<typename T>
+		std::size_t input_size(const T& in) {
+			return input_size(in, 0);
+		}
+
+		/**
+		 * Calls the i-th of the given versions. The versions are dispatched through a
+		 * table of functions, thus in constant time.
+		 */
+		template<std::size_t i, typename Res, typename Versions, typename ... Args>
+		Res call_version(const Versions& versions, const Args& ... args) {
+			return std::get<i>(versions)(args...);
+		}
+
+		template<typename Res, typename Versions, typename ... Args, std::size_t ... Is>
+		Res call_version(std::size_t i, const Versions& versions, std::index_sequence<Is...>, const Args& ... args) {
+			using fun = Res(*)(const Versions&, const Args& ...);
+			static const fun table[] = { &call_version<Is,Res,Versions,Args...>... };
+			return table[i](versions, args...);
+		}
+
+	}
+
+	/**
+	 * The measurements of one version for inputs of one size bucket.
+	 */
+	struct VersionStatistics {
+
+		// the size bucket, covering inputs of sizes in [2^(bucket-1), 2^bucket)
+		unsigned bucket;
+
+		// the index of the version within the pick
+		unsigned version;
+
+		// the number of calls being timed
+		std::uint64_t samples;
+
+		// the average time of the timed calls, in nanoseconds
+		std::uint64_t average_time;
+
+		// whether this version is the fastest one of its bucket
+		bool best;
+
+		friend std::ostream& operator<<(std::ostream& out, const VersionStatistics& stats) {
+			return out << "bucket " << stats.bucket << ", version " << stats.version
+					<< ": " << stats.samples << " samples, " << stats.average_time << "ns"
+					<< (stats.best ? " (best)" : "");
+		}
+
+	};
+
+	/**
+	 * Tracks the versions of a pick chosen for the calls of a definition. Its state is
+	 * shared by all copies of the definition and may be accessed concurrently.
+	 *
+	 * When autotuning, each version is timed a few times for every size bucket first.
+	 * Afterwards, the fastest version is chosen; randomly selected calls are timed to
+	 * follow changes (one in sample_rate) or try another version (one in explore_rate).
+	 * Calls not being timed only read the shared state.
+	 */
+	class VersionTuner {
+
+	public:
+
+		// the number of input size buckets
+		static const unsigned num_buckets = 64;
+
+		// the number of timed calls of each version before converging
+		static const unsigned min_samples = 4;
+
+		// the frequency of timing calls of the fastest version
+		static const unsigned sample_rate = 16;
+
+		// the frequency of calling other versions than the fastest one
+		static const unsigned explore_rate = 64;
+
+	private:
+
+		struct Record {
+			std::atomic<std::uint64_t> samples;
+			std::atomic<std::uint64_t> time;
+			Record() : samples(0), time(0) {}
+		};
+
+		unsigned num_versions;
+
+		std::atomic<SelectionPolicy> policy;
+
+		std::atomic<unsigned> next;
+
+		// the fastest version of each bucket
+		std::unique_ptr<std::atomic<unsigned>[]> best;
+
+		// the records of the versions, num_versions per bucket
+		std::unique_ptr<Record[]> records;
+
+	public:
+
+		VersionTuner(unsigned num_versions, SelectionPolicy policy = getDefaultSelectionPolicy())
+			: num_versions(num_versions), policy(policy), next(0),
+			  best(new std::atomic<unsigned>[num_buckets]), records(new Record[num_buckets * num_versions]) {
+			for(unsigned i=0; i<num_buckets; ++i) best[i] = 0;
+		}
+
+		unsigned getNumVersions() const {
+			return num_versions;
+		}
+
+		SelectionPolicy getPolicy() const {
+			return policy.load(std::memory_order_relaxed);
+		}
+
+		void setPolicy(SelectionPolicy p) {
+			policy.store(p, std::memory_order_relaxed);
+		}
+
+		/**
+		 * Obtains the bucket of inputs of the given size, the number of its significant bits.
+		 */
+		static unsigned getBucket(std::size_t size) {
+			unsigned res = 0;
+			while (size > 0 && res < num_buckets - 1) {
+				size >>= 1;
+				++res;
+			}
+			return res;
+		}
+
+		/**
+		 * Chooses a version for an input of the given size according to the policy.
+		 * The flag measure is set if the call is to be timed and reported by record.
+		 */
+		unsigned choose(std::size_t size, bool& measure) {
+			measure = false;
+			switch(getPolicy()) {
+				case SelectionPolicy::Random:
+					return detail::fastRand() % num_versions;
+				case SelectionPolicy::RoundRobin:
+					return next.fetch_add(1, std::memory_order_relaxed) % num_versions;
+				case SelectionPolicy::Autotune:
+					break;
+			}
+
+			unsigned b = getBucket(size);
+			measure = true;
+
+			// time every version a few times first
+			Record* cur = &records[b * num_versions];
+			for(unsigned i=0; i<num_versions; ++i) {
+				if (cur[i].samples.load(std::memory_order_relaxed) < min_samples) return i;
+			}
+
+			// explore other versions once in a while
+			auto r = detail::fastRand();
+			if (r % explore_rate == 0) return (r / explore_rate) % num_versions;
+
+			measure = (r % sample_rate == 0);
+			return best[b].load(std::memory_order_relaxed);
+		}
+
+		/**
+		 * Chooses a version for a call which is not going to be timed. When autotuning,
+		 * this is the fastest version measured so far.
+		 */
+		unsigned choose(std::size_t size) {
+			switch(getPolicy()) {
+				case SelectionPolicy::Random:
+					return detail::fastRand() % num_versions;
+				case SelectionPolicy::RoundRobin:
+					return next.fetch_add(1, std::memory_order_relaxed) % num_versions;
+				case SelectionPolicy::Autotune:
+					break;
+			}
+			return getBest(size);
+		}
+
+		/**
+		 * Records the time of a call timed upon request of choose.
+		 */
+		void record(std::size_t size, unsigned version, std::chrono::nanoseconds time) {
+			unsigned b = getBucket(size);
+			Record* cur = &records[b * num_versions];
+			cur[version].samples.fetch_add(1, std::memory_order_relaxed);
+			cur[version].time.fetch_add(time.count(), std::memory_order_relaxed);
+
+			// update the fastest version of the bucket
+			unsigned fastest = 0;
+			double fastestTime = 0;
+			for(unsigned i=0; i<num_versions; ++i) {
+				auto samples = cur[i].samples.load(std::memory_order_relaxed);
+				if (samples == 0) continue;
+				double avg = double(cur[i].time.load(std::memory_order_relaxed)) / samples;
+				if (fastestTime == 0 || avg < fastestTime) {
+					fastest = i;
+					fastestTime = avg;
+				}
+			}
+			best[b].store(fastest, std::memory_order_relaxed);
+		}
+
+		/**
+		 * Obtains the fastest version for inputs of the given size measured so far.
+		 */
+		unsigned getBest(std::size_t size) const {
+			return best[getBucket(size)].load(std::memory_order_relaxed);
+		}
+
+		/**
+		 * Obtains the measurements of all versions timed so far.
+		 */
+		std::vector<VersionStatistics> getStatistics() const {
+			std::vector<VersionStatistics> res;
+			for(unsigned b=0; b<num_buckets; ++b) {
+				for(unsigned i=0; i<num_versions; ++i) {
+					const Record& cur = records[b * num_versions + i];
+					auto samples = cur.samples.load(std::memory_order_relaxed);
+					if (samples == 0) continue;
+					auto time = cur.time.load(std::memory_order_relaxed);
+					res.push_back({ b, i, samples, time / samples, best[b].load(std::memory_order_relaxed) == i });
+				}
+			}
+			return res;
+		}
+
+		friend std::ostream& operator<<(std::ostream& out, const VersionTuner& tuner) {
+			out << "Selection policy: " << tuner.getPolicy() << "\n";
+			for(const auto& cur : tuner.getStatistics()) {
+				out << cur << "\n";
+			}
+			return out;
+		}
+
+	};
+
+	namespace detail {
+
+		/**
+		 * Calls one of the alternative versions of a base or step case, chosen by the
+		 * tuner shared by all copies of the definition.
+		 *
+		 * Only calls whose execution time reflects the work of the chosen version may be
+		 * timed: base cases and step cases processed sequentially, whose time covers the
+		 * computation of their subtree. Those are comparable among the versions of a size
+		 * bucket, since all of them solve the same sub-problems. Step cases spawning their
+		 * sub-calls would measure scheduling delays and the load of the pool instead; they
+		 * are called through call_untimed, using the fastest version measured so far.
+		 */
+		template<std::size_t N>
+		class version_selector {
+
+			std::shared_ptr<VersionTuner> tuner;
+
+		public:
+
+			version_selector() : tuner(std::make_shared<VersionTuner>(N)) {}
+
+			VersionTuner* getTuner() const {
+				return tuner.get();
+			}
+
+			template<typename Res, typename Versions, typename In, typename ... Args>
+			Res call(const Versions& versions, const In& in, const Args& ... args) const {
+				auto size = input_size(in);
+				bool measure;
+				unsigned i = tuner->choose(size, measure);
+				if (!measure) return call_version<Res>(i, versions, std::make_index_sequence<N>(), in, args...);
+
+				// the time is recorded once the version is done, even if it fails
+				struct timer {
+					VersionTuner& tuner;
+					std::size_t size;
+					unsigned version;
+					std::chrono::steady_clock::time_point begin;
+					~timer() {
+						tuner.record(size, version, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin));
+					}
+				} t { *tuner, size, i, std::chrono::steady_clock::now() };
+				return call_version<Res>(i, versions, std::make_index_sequence<N>(), in, args...);
+			}
+
+			template<typename Res, typename Versions, typename In, typename ... Args>
+			Res call_untimed(const Versions& versions, const In& in, const Args& ... args) const {
+				unsigned i = tuner->choose(input_size(in));
+				return call_version<Res>(i, versions, std::make_index_sequence<N>(), in, args...);
+			}
+
+		};
+
+		/**
+		 * Without alternatives, the single version is called directly.
+		 */
+		template<>
+		class version_selector<1> {
+
+		public:
+
+			VersionTuner* getTuner() const {
+				return nullptr;
+			}
+
+			template<typename Res, typename Versions, typename In, typename ... Args>
+			Res call(const Versions& versions, const In& in, const Args& ... args) const {
+				return std::get<0>(versions)(in, args...);
+			}
+
+			template<typename Res, typename Versions, typename In, typename ... Args>
+			Res call_untimed(const Versions& versions, const In& in, const Args& ... args) const {
+				return std::get<0>(versions)(in, args...);
+			}
+
+		};
+
+	}
+
+} // end namespace parec
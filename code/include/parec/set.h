@@ -119,9 +119,13 @@ namespace parec {
 							// if they are the same pointer, we are done
 							if (x == o) return true;
 
+							// abandon the remaining checks once a missing element is found
+							auto token = CancellationToken::create();
+							CancellationScope scope(token);
+
 							// if values are equivalent ...
 							if (x->value == o->value) {
-								return all(
+								return all(token,
 									f(pair(x->l,o->l)),
 									f(pair(x->r,o->r))
 								);
@@ -131,7 +135,7 @@ namespace parec {
 
 								node tmp(o->value);
 
-								return all(
+								return all(token,
 									f(pair(x, o->l)),
 									f(pair(x->r, o->r)),
 									f(pair(x->r, &tmp))
@@ -140,7 +144,7 @@ namespace parec {
 							}
 
 							node tmp(o->value);
-							return all(
+							return all(token,
 								f(pair(x->l, o->l)),
 								f(pair(x->l, &tmp)),
 								f(pair(x, o->r))
@@ -268,7 +272,9 @@ namespace parec {
 		}
 
 		bool operator==(const set<T>& other) const {
-			return all(
+			auto token = CancellationToken::create();
+			CancellationScope scope(token);
+			return all(token,
 				async([&]()->bool { return this->isSubsetOf(other); }),
 				async([&]()->bool { return other.isSubsetOf(*this); })
 			);
@@ -208,8 +208,8 @@ namespace parec {
 					)
 			);
 
-			auto s_u = parec<0>(def);
-			auto s_d = parec<1>(def);
+			auto s_u = label("stencil", parec<0>(def));
+			auto s_d = label("stencil", parec<1>(def));
 
 			// process layer by layer
 			auto N = a.size();
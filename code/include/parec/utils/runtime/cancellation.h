@@ -0,0 +1,236 @@
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <utility>
+
+namespace parec {
+namespace utils {
+namespace runtime {
+
+	/**
+	 * The outcome of operations abandoned due to a cancellation. Futures of skipped
+	 * operations carry this exception instead of a value, such that they can be told
+	 * apart from completed ones.
+	 */
+	class operation_cancelled : public std::exception {
+	public:
+		const char* what() const noexcept override {
+			return "operation cancelled";
+		}
+	};
+
+	/**
+	 * Determines whether the given failure is the outcome of an abandoned operation.
+	 */
+	inline bool isCancellation(const std::exception_ptr& error) {
+		if (!error) return false;
+		try {
+			std::rethrow_exception(error);
+		} catch (const operation_cancelled&) {
+			return true;
+		} catch (...) {
+			return false;
+		}
+	}
+
+	namespace detail {
+
+		/**
+		 * The shared state of a cancellation token. A state is cancelled if it or any of
+		 * its ancestors has been cancelled.
+		 */
+		class cancel_state {
+
+			std::atomic<bool> cancelled;
+
+			std::atomic<int> refs;
+
+			cancel_state* parent;
+
+			// the first failure cancelling this state, published by the recorded flag
+			std::atomic<bool> failing;
+			std::atomic<bool> recorded;
+			std::exception_ptr failure;
+
+		public:
+
+			explicit cancel_state(cancel_state* parent)
+				: cancelled(false), refs(1), parent(parent), failing(false), recorded(false) {
+				if (parent) parent->incRef();
+			}
+
+			cancel_state(const cancel_state&) = delete;
+			cancel_state& operator=(const cancel_state&) = delete;
+
+			void incRef() {
+				refs.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			void decRef() {
+				// release the chain of ancestors iteratively
+				cancel_state* cur = this;
+				while(cur && cur->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+					cancel_state* next = cur->parent;
+					delete cur;
+					cur = next;
+				}
+			}
+
+			void cancel() {
+				cancelled.store(true, std::memory_order_relaxed);
+			}
+
+			void fail(const std::exception_ptr& error) {
+				if (!failing.exchange(true, std::memory_order_relaxed)) {
+					failure = error;
+					recorded.store(true, std::memory_order_release);
+				}
+				cancel();
+			}
+
+			std::exception_ptr getFailure() const {
+				return recorded.load(std::memory_order_acquire) ? failure : std::exception_ptr();
+			}
+
+			bool isCancelled() const {
+				for(const cancel_state* cur = this; cur; cur = cur->parent) {
+					if (cur->cancelled.load(std::memory_order_relaxed)) return true;
+				}
+				return false;
+			}
+
+		};
+
+		inline cancel_state*& currentCancelState() {
+			thread_local static cancel_state* state = nullptr;
+			return state;
+		}
+
+	}
+
+	/**
+	 * A handle on a cancellation request. Tasks inherit the token of the scope they are
+	 * spawned in (see CancellationScope), thus a token covers whole recursions. Once a
+	 * token has been cancelled, the tasks spawned under it are discarded instead of being
+	 * processed, and running operations may stop early by polling isCancelled().
+	 *
+	 * A default-constructed token is never cancelled.
+	 */
+	class CancellationToken {
+
+		detail::cancel_state* state;
+
+		explicit CancellationToken(detail::cancel_state* state) : state(state) {}
+
+	public:
+
+		CancellationToken() : state(nullptr) {}
+
+		CancellationToken(const CancellationToken& other) : state(other.state) {
+			if (state) state->incRef();
+		}
+
+		CancellationToken(CancellationToken&& other) : state(other.state) {
+			other.state = nullptr;
+		}
+
+		~CancellationToken() {
+			if (state) state->decRef();
+		}
+
+		CancellationToken& operator=(const CancellationToken& other) {
+			CancellationToken copy(other);
+			std::swap(state, copy.state);
+			return *this;
+		}
+
+		CancellationToken& operator=(CancellationToken&& other) {
+			std::swap(state, other.state);
+			return *this;
+		}
+
+		/**
+		 * Creates a new token which is cancelled along with the token of the current scope.
+		 */
+		static CancellationToken create() {
+			return CancellationToken(new detail::cancel_state(detail::currentCancelState()));
+		}
+
+		/**
+		 * Obtains the token of the current scope.
+		 */
+		static CancellationToken getCurrent() {
+			auto state = detail::currentCancelState();
+			if (state) state->incRef();
+			return CancellationToken(state);
+		}
+
+		/**
+		 * Requests the cancellation of all operations spawned under this token. Has no
+		 * effect on a default-constructed token.
+		 */
+		void cancel() {
+			if (state) state->cancel();
+		}
+
+		bool isCancelled() const {
+			return state && state->isCancelled();
+		}
+
+		/**
+		 * Cancels this token due to the given failure of an operation spawned under it,
+		 * and obtains the failure to be reported for the operation. The first failure
+		 * other than a cancellation is recorded; operations failing since their own
+		 * sub-operations have been abandoned report the recorded failure instead, such
+		 * that it reaches the root of the cancelled computation.
+		 */
+		std::exception_ptr fail(const std::exception_ptr& error) {
+			if (!state) return error;
+			if (!isCancellation(error)) {
+				state->fail(error);
+				return error;
+			}
+			state->cancel();
+			auto cause = state->getFailure();
+			return cause ? cause : error;
+		}
+
+		friend class CancellationScope;
+
+	};
+
+	/**
+	 * Makes the given token the token of the current thread for the life time of the
+	 * scope. Tasks spawned within the scope inherit the token.
+	 */
+	class CancellationScope {
+
+		detail::cancel_state* previous;
+
+	public:
+
+		explicit CancellationScope(const CancellationToken& token) : previous(detail::currentCancelState()) {
+			detail::currentCancelState() = token.state;
+		}
+
+		~CancellationScope() {
+			detail::currentCancelState() = previous;
+		}
+
+		CancellationScope(const CancellationScope&) = delete;
+		CancellationScope& operator=(const CancellationScope&) = delete;
+
+	};
+
+	/**
+	 * Determines whether the operation processed by the current thread has been cancelled.
+	 */
+	inline bool isCancelled() {
+		auto state = detail::currentCancelState();
+		return state && state->isCancelled();
+	}
+
+} // end namespace runtime
+} // end namespace utils
+} // end namespace parec
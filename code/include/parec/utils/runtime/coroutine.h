@@ -0,0 +1,129 @@
+#pragma once
+
+#include "parec/utils/runtime/runtime.h"
+
+/**
+ * Coroutine support, only available when compiling with C++20 (see the USE_CXX20 build
+ * option). Functions returning a Future may then be written as coroutines, and futures
+ * may be awaited using co_await. Other than Future::get, which processes other tasks on
+ * top of the current stack while waiting, co_await suspends the coroutine, releasing the
+ * thread. The coroutine is resumed by the thread completing the awaited future.
+ */
+
+#ifdef __cpp_impl_coroutine
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+
+#define PAREC_HAS_COROUTINES 1
+
+namespace parec {
+namespace utils {
+namespace runtime {
+
+	namespace detail {
+
+		/**
+		 * The state of a coroutine producing a future. Coroutines start immediately on the
+		 * calling thread and run until they complete or await a future not being ready.
+		 */
+		template<typename T>
+		struct coroutine_promise_base {
+
+			Promise<T> promise;
+
+			Future<T> get_return_object() {
+				return promise.getFuture();
+			}
+
+			std::suspend_never initial_suspend() noexcept {
+				return {};
+			}
+
+			std::suspend_never final_suspend() noexcept {
+				return {};
+			}
+
+			void unhandled_exception() {
+				// a failure abandons the sibling operations, as for ordinary tasks
+				promise.setException(CancellationToken::getCurrent().fail(std::current_exception()));
+			}
+
+		};
+
+		template<typename T>
+		struct coroutine_promise : public coroutine_promise_base<T> {
+			void return_value(const T& value) {
+				this->promise.set(value);
+			}
+			void return_value(T&& value) {
+				this->promise.set(std::move(value));
+			}
+		};
+
+		template<>
+		struct coroutine_promise<void> : public coroutine_promise_base<void> {
+			void return_void() {
+				this->promise.set();
+			}
+		};
+
+		/**
+		 * Suspends a coroutine until the given handle is ready. The coroutine is resumed
+		 * in the cancellation scope it has been suspended in.
+		 */
+		template<typename Handle>
+		struct handle_awaiter {
+
+			const Handle& handle;
+
+			// set by the first of the suspending thread and the completing thread
+			std::atomic<bool> arrived;
+
+			bool await_ready() const {
+				return handle.isDone();
+			}
+
+			bool await_suspend(std::coroutine_handle<> coroutine) {
+				handle.onReady([this,coroutine,token=CancellationToken::getCurrent()]() {
+					// if the handle got ready while suspending, the coroutine just continues
+					if (!arrived.exchange(true)) return;
+					CancellationScope scope(token);
+					coroutine.resume();
+				});
+				return !arrived.exchange(true);
+			}
+
+			decltype(auto) await_resume() const {
+				return handle.get();
+			}
+
+		};
+
+	}
+
+	template<typename T>
+	detail::handle_awaiter<Future<T>> operator co_await(const Future<T>& future) {
+		return { future, false };
+	}
+
+	template<typename T>
+	detail::handle_awaiter<Immediate<T>> operator co_await(const Immediate<T>& immediate) {
+		return { immediate, false };
+	}
+
+} // end namespace runtime
+} // end namespace utils
+} // end namespace parec
+
+namespace std {
+
+	template<typename T, typename ... Args>
+	struct coroutine_traits<parec::utils::runtime::Future<T>, Args...> {
+		using promise_type = parec::utils::runtime::detail::coroutine_promise<T>;
+	};
+
+} // end namespace std
+
+#endif
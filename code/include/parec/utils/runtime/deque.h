@@ -0,0 +1,383 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace parec {
+namespace utils {
+namespace runtime {
+
+	/**
+	 * The assumed size of a cache line. Data modified by different threads is kept this
+	 * far apart to avoid false sharing.
+	 */
+	static const std::size_t cache_line_size = 64;
+
+	/**
+	 * A growable, lock-free work-stealing deque following the design of Chase and Lev
+	 * ("Dynamic Circular Work-Stealing Deque", SPAA'05) using the memory orderings
+	 * proposed by Le et al. ("Correct and Efficient Work-Stealing for Weak Memory
+	 * Models", PPoPP'13).
+	 *
+	 * The deque has a single owner and an arbitrary number of thieves:
+	 *  - the owner pushes and pops at the back (LIFO order) -- push_back and pop_back
+	 *    may only be called by the owning thread
+	 *  - thieves take elements from the front (FIFO order) -- steal may be called by
+	 *    any thread
+	 *
+	 * Elements have to be pointers; a null pointer is returned whenever no element could
+	 * be obtained.
+	 */
+	template<typename T>
+	class WorkStealingDeque {
+
+		static_assert(std::is_pointer<T>::value, "Only pointers may be stored in a work-stealing deque!");
+
+		/**
+		 * A circular buffer of a power-of-two capacity.
+		 */
+		class Buffer {
+
+			std::int64_t mask;
+
+			std::atomic<T>* data;
+
+		public:
+
+			Buffer(std::int64_t capacity)
+				: mask(capacity-1), data(new std::atomic<T>[capacity]) {}
+
+			~Buffer() {
+				delete [] data;
+			}
+
+			std::int64_t capacity() const {
+				return mask + 1;
+			}
+
+			T get(std::int64_t i) const {
+				return data[i & mask].load(std::memory_order_relaxed);
+			}
+
+			void put(std::int64_t i, T t) {
+				data[i & mask].store(t, std::memory_order_relaxed);
+			}
+
+			Buffer* grow(std::int64_t front, std::int64_t back) const {
+				auto res = new Buffer(2*capacity());
+				for(std::int64_t i = front; i<back; ++i) {
+					res->put(i,get(i));
+				}
+				return res;
+			}
+
+		};
+
+		// the index of the oldest element, modified by thieves
+		alignas(cache_line_size) std::atomic<std::int64_t> front;
+
+		// the index following the newest element and the current buffer, modified by the
+		// owner only, thus thieves are not invalidating this line
+		alignas(cache_line_size) std::atomic<std::int64_t> back;
+		std::atomic<Buffer*> buffer;
+
+		// buffers replaced by bigger ones, thieves may still read from those; accessed by
+		// the owner only, and only while growing
+		alignas(cache_line_size) std::vector<Buffer*> retired;
+
+	public:
+
+		WorkStealingDeque(std::int64_t capacity = 64)
+			: front(0), back(0), buffer(new Buffer(roundUp(capacity))) {}
+
+		~WorkStealingDeque() {
+			delete buffer.load(std::memory_order_relaxed);
+			for(auto cur : retired) delete cur;
+		}
+
+		WorkStealingDeque(const WorkStealingDeque&) = delete;
+		WorkStealingDeque(WorkStealingDeque&&) = delete;
+
+		WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+		WorkStealingDeque& operator=(WorkStealingDeque&&) = delete;
+
+		/**
+		 * Tests whether this deque is empty. The result is only a hint if
+		 * thieves or the owner are concurrently operating on the deque.
+		 */
+		bool empty() const {
+			return size() == 0;
+		}
+
+		/**
+		 * Obtains the number of elements in this deque. The result is only a
+		 * hint if thieves or the owner are concurrently operating on the deque.
+		 */
+		std::size_t size() const {
+			auto b = back.load(std::memory_order_relaxed);
+			auto f = front.load(std::memory_order_relaxed);
+			return (b > f) ? b - f : 0;
+		}
+
+		/**
+		 * Obtains the current capacity of the underlying buffer.
+		 */
+		std::size_t capacity() const {
+			return buffer.load(std::memory_order_relaxed)->capacity();
+		}
+
+		/**
+		 * Adds a new element to the back of this deque. Owner only.
+		 */
+		void push_back(T t) {
+			auto b = back.load(std::memory_order_relaxed);
+			auto f = front.load(std::memory_order_acquire);
+			auto a = buffer.load(std::memory_order_relaxed);
+
+			// grow buffer if full
+			if (b - f > a->capacity() - 1) {
+				retired.push_back(a);
+				a = a->grow(f,b);
+				buffer.store(a, std::memory_order_release);
+			}
+
+			a->put(b,t);
+			std::atomic_thread_fence(std::memory_order_release);
+			back.store(b+1, std::memory_order_relaxed);
+		}
+
+		/**
+		 * Adds the n elements produced by gen(0) ... gen(n-1) to the back of this deque,
+		 * publishing all of them at once. Owner only.
+		 */
+		template<typename Gen>
+		void push_back_n(std::size_t n, const Gen& gen) {
+			auto b = back.load(std::memory_order_relaxed);
+			auto f = front.load(std::memory_order_acquire);
+			auto a = buffer.load(std::memory_order_relaxed);
+
+			// grow buffer until all elements fit
+			auto count = static_cast<std::int64_t>(n);
+			while (b - f + count > a->capacity()) {
+				retired.push_back(a);
+				a = a->grow(f,b);
+				buffer.store(a, std::memory_order_release);
+			}
+
+			for(std::int64_t i=0; i<count; ++i) {
+				a->put(b+i,gen(i));
+			}
+			std::atomic_thread_fence(std::memory_order_release);
+			back.store(b+count, std::memory_order_relaxed);
+		}
+
+		/**
+		 * Obtains the position the next element pushed to this deque will be stored at.
+		 * Positions only decrease when elements are popped from the back. Owner only.
+		 */
+		std::int64_t position() const {
+			return back.load(std::memory_order_relaxed);
+		}
+
+		/**
+		 * Removes the newest element from the back of this deque if it is stored at the
+		 * given position or above, otherwise null is returned. Owner only.
+		 */
+		T pop_back_from(std::int64_t pos) {
+			if (back.load(std::memory_order_relaxed) <= pos) return nullptr;
+			return pop_back();
+		}
+
+		/**
+		 * Removes the newest element from the back of this deque. Owner only.
+		 */
+		T pop_back() {
+			auto b = back.load(std::memory_order_relaxed) - 1;
+			auto a = buffer.load(std::memory_order_relaxed);
+			back.store(b, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			auto f = front.load(std::memory_order_relaxed);
+
+			// check whether the deque was empty
+			if (f > b) {
+				back.store(b+1, std::memory_order_relaxed);
+				return nullptr;
+			}
+
+			T res = a->get(b);
+			if (f == b) {
+				// this is the last element => race with thieves
+				if (!front.compare_exchange_strong(f, f+1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+					res = nullptr;
+				}
+				back.store(b+1, std::memory_order_relaxed);
+			}
+			return res;
+		}
+
+		/**
+		 * Removes the oldest element from the front of this deque. May be called
+		 * by any thread. Returns null if the deque is empty or the element was
+		 * taken by a concurrent operation.
+		 */
+		T steal() {
+			auto f = front.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			auto b = back.load(std::memory_order_acquire);
+
+			if (f >= b) return nullptr;
+
+			auto a = buffer.load(std::memory_order_acquire);
+			T res = a->get(f);
+			if (!front.compare_exchange_strong(f, f+1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+				return nullptr;
+			}
+			return res;
+		}
+
+		/**
+		 * Steals up to half of the elements of this deque, but at most max, in a single
+		 * round. The oldest element obtained is returned, the others are appended to the
+		 * given target deque, which has to be owned by the calling thread. Elements are
+		 * stolen one at a time, each of them with the guarantees of steal. Returns null
+		 * if no element could be obtained.
+		 */
+		T steal_half(WorkStealingDeque& target, std::size_t max) {
+			// take the first element
+			T res = steal();
+			if (!res) return nullptr;
+
+			// take up to half of the remaining elements
+			auto n = std::min<std::size_t>(size() / 2, (max > 0) ? max - 1 : 0);
+			for(std::size_t i=0; i<n; ++i) {
+				T cur = steal();
+				if (!cur) break;
+				target.push_back(cur);
+			}
+			return res;
+		}
+
+	private:
+
+		static std::int64_t roundUp(std::int64_t capacity) {
+			std::int64_t res = 1;
+			while(res < capacity) res <<= 1;
+			return res;
+		}
+
+	};
+
+	/**
+	 * A bounded, lock-free multi-producer multi-consumer FIFO queue following the design
+	 * of Vyukov (http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue).
+	 * Each cell carries a sequence number telling producers and consumers whether it is
+	 * their turn, thus producers and consumers only contend on their respective index.
+	 *
+	 * Elements have to be pointers; a null pointer is returned whenever no element could
+	 * be obtained.
+	 */
+	template<typename T, std::size_t capacity>
+	class MPMCQueue {
+
+		static_assert(std::is_pointer<T>::value, "Only pointers may be stored in a MPMC queue!");
+		static_assert(capacity > 1 && (capacity & (capacity-1)) == 0, "Capacity must be a power of two!");
+
+		struct Cell {
+			std::atomic<std::size_t> sequence;
+			T data;
+		};
+
+		static const std::size_t mask = capacity - 1;
+
+		std::vector<Cell> cells;
+
+		// the producer and consumer indices, kept on distinct cache lines
+		char pad0[cache_line_size];
+		std::atomic<std::size_t> back;
+		char pad1[cache_line_size - sizeof(std::atomic<std::size_t>)];
+		std::atomic<std::size_t> front;
+		char pad2[cache_line_size - sizeof(std::atomic<std::size_t>)];
+
+	public:
+
+		MPMCQueue() : cells(capacity), back(0), front(0) {
+			for(std::size_t i=0; i<capacity; ++i) {
+				cells[i].sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+
+		MPMCQueue(const MPMCQueue&) = delete;
+		MPMCQueue(MPMCQueue&&) = delete;
+
+		MPMCQueue& operator=(const MPMCQueue&) = delete;
+		MPMCQueue& operator=(MPMCQueue&&) = delete;
+
+		/**
+		 * Tests whether this queue is empty. The result is only a hint if other threads
+		 * are concurrently operating on the queue.
+		 */
+		bool empty() const {
+			return front.load(std::memory_order_acquire) >= back.load(std::memory_order_acquire);
+		}
+
+		/**
+		 * Appends the given element to this queue. Returns false if the queue is full.
+		 */
+		bool push_back(T t) {
+			auto pos = back.load(std::memory_order_relaxed);
+			while(true) {
+				Cell& cell = cells[pos & mask];
+				auto seq = cell.sequence.load(std::memory_order_acquire);
+				auto diff = std::intptr_t(seq) - std::intptr_t(pos);
+				if (diff == 0) {
+					// the cell is free => try to claim it
+					if (back.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) {
+						cell.data = t;
+						cell.sequence.store(pos+1, std::memory_order_release);
+						return true;
+					}
+				} else if (diff < 0) {
+					// the cell still holds the element of the previous round
+					return false;
+				} else {
+					// some other producer has been faster
+					pos = back.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		/**
+		 * Removes the oldest element of this queue. Returns null if the queue is empty.
+		 */
+		T pop_front() {
+			auto pos = front.load(std::memory_order_relaxed);
+			while(true) {
+				Cell& cell = cells[pos & mask];
+				auto seq = cell.sequence.load(std::memory_order_acquire);
+				auto diff = std::intptr_t(seq) - std::intptr_t(pos+1);
+				if (diff == 0) {
+					// the cell is filled => try to claim it
+					if (front.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) {
+						T res = cell.data;
+						cell.sequence.store(pos+capacity, std::memory_order_release);
+						return res;
+					}
+				} else if (diff < 0) {
+					// the cell has not been filled yet
+					return nullptr;
+				} else {
+					// some other consumer has been faster
+					pos = front.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+	};
+
+} // end namespace runtime
+} // end namespace utils
+} // end namespace parec
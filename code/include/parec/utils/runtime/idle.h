@@ -0,0 +1,93 @@
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+namespace parec {
+namespace utils {
+namespace runtime {
+
+	/**
+	 * The strategy of workers running out of work. Idle workers pass through up to three
+	 * phases, each of which ends as soon as some task is found:
+	 *
+	 *  - spinning: polling for tasks, pausing the CPU between two polls
+	 *  - yielding: polling for tasks, yielding the CPU between two polls
+	 *  - parking:  sleeping until new work is announced or the timeout expires
+	 *
+	 * Long spinning phases minimize the latency of bursts of work, parking early releases
+	 * the CPUs for other processes sharing the node.
+	 */
+	struct IdlePolicy {
+
+		// the number of polling rounds while spinning
+		int spin_cycles = 1000;
+
+		// whether the pause between two polls is doubled every round while spinning
+		bool backoff = false;
+
+		// the upper limit of pause instructions between two polls when backing off
+		int max_backoff = 64;
+
+		// the number of polling rounds while yielding
+		int yield_cycles = 0;
+
+		// whether idle workers should sleep after polling or keep yielding
+		bool park = true;
+
+		// the time a worker sleeps before polling again, zero to sleep until woken up
+		std::chrono::microseconds park_timeout = std::chrono::microseconds(0);
+
+		/**
+		 * A policy for latency-critical bursts of work: workers keep spinning for a long
+		 * time with exponential backoff, yield for a while and only then go to sleep.
+		 */
+		static IdlePolicy latency() {
+			IdlePolicy res;
+			res.spin_cycles = 100000;
+			res.backoff = true;
+			res.yield_cycles = 1000;
+			return res;
+		}
+
+		/**
+		 * The default policy: a short spinning phase followed by sleeping.
+		 */
+		static IdlePolicy balanced() {
+			return IdlePolicy();
+		}
+
+		/**
+		 * A policy for batch jobs sharing a node: workers go to sleep almost immediately.
+		 */
+		static IdlePolicy batch() {
+			IdlePolicy res;
+			res.spin_cycles = 10;
+			return res;
+		}
+
+		/**
+		 * Obtains the policy of the given name (latency, balanced or batch). The balanced
+		 * policy is returned for unknown names.
+		 */
+		static IdlePolicy fromName(const std::string& name) {
+			if (name == "latency") return latency();
+			if (name == "batch") return batch();
+			return balanced();
+		}
+
+		friend std::ostream& operator<<(std::ostream& out, const IdlePolicy& policy) {
+			out << "spin " << policy.spin_cycles;
+			if (policy.backoff) out << " (backoff up to " << policy.max_backoff << ")";
+			out << ", yield " << policy.yield_cycles;
+			if (!policy.park) return out << ", no parking";
+			if (policy.park_timeout.count() == 0) return out << ", park";
+			return out << ", park for " << policy.park_timeout.count() << "us";
+		}
+
+	};
+
+} // end namespace runtime
+} // end namespace utils
+} // end namespace parec
@@ -1,8 +1,15 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <climits>
+#include <ctime>
 #include <thread>
 
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
 namespace parec {
 namespace utils {
 namespace runtime {
@@ -51,6 +58,175 @@ namespace runtime {
         }
     };
 
+	/**
+	 * An event count enabling threads to block until some condition becomes true
+	 * without requiring notifiers to perform any kernel calls unless there are
+	 * waiting threads. Waiting is a three-step protocol:
+	 *
+	 *		auto key = events.prepareWait();
+	 *		if (condition) { events.cancelWait(); } else { events.commitWait(key); }
+	 *
+	 * Notifiers have to establish the condition before calling notify.
+	 */
+	class EventCount {
+
+		// the number of threads in the process of waiting
+		std::atomic<int> waiters;
+
+		// incremented with every notification, used as the futex word
+		std::atomic<int> epoch;
+
+	public:
+
+		EventCount() : waiters(0), epoch(0) {}
+
+		EventCount(const EventCount&) = delete;
+		EventCount(EventCount&&) = delete;
+
+		EventCount& operator=(const EventCount&) = delete;
+		EventCount& operator=(EventCount&&) = delete;
+
+		/**
+		 * Obtains the number of threads currently waiting or preparing to wait.
+		 */
+		int getNumWaiters() const {
+			return waiters.load(std::memory_order_relaxed);
+		}
+
+		/**
+		 * Registers the calling thread as a waiter. The wait condition has to be
+		 * re-checked after this call.
+		 */
+		int prepareWait() {
+			waiters.fetch_add(1, std::memory_order_seq_cst);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			return epoch.load(std::memory_order_seq_cst);
+		}
+
+		/**
+		 * Aborts a wait prepared by prepareWait.
+		 */
+		void cancelWait() {
+			waiters.fetch_sub(1, std::memory_order_seq_cst);
+		}
+
+		/**
+		 * Blocks until a notification following the matching prepareWait call.
+		 */
+		void commitWait(int key) {
+			while(epoch.load(std::memory_order_seq_cst) == key) {
+				futex(FUTEX_WAIT_PRIVATE, key);
+			}
+			waiters.fetch_sub(1, std::memory_order_seq_cst);
+		}
+
+		/**
+		 * Like commitWait, but gives up once the given timeout expires. Returns whether
+		 * a notification has been received.
+		 */
+		bool commitWait(int key, std::chrono::nanoseconds timeout) {
+			auto deadline = std::chrono::steady_clock::now() + timeout;
+			bool notified = true;
+			while(epoch.load(std::memory_order_seq_cst) == key) {
+				auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - std::chrono::steady_clock::now()).count();
+				if (remaining <= 0) {
+					notified = false;
+					break;
+				}
+				timespec time = { time_t(remaining / 1000000000), long(remaining % 1000000000) };
+				futex(FUTEX_WAIT_PRIVATE, key, &time);
+			}
+			waiters.fetch_sub(1, std::memory_order_seq_cst);
+			return notified;
+		}
+
+		/**
+		 * Wakes up at most one waiting thread.
+		 */
+		void notifyOne() {
+			notify(1);
+		}
+
+		/**
+		 * Wakes up all waiting threads.
+		 */
+		void notifyAll() {
+			notify(INT_MAX);
+		}
+
+	private:
+
+		void notify(int count) {
+			// order the establishment of the condition before reading the number of waiters
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (waiters.load(std::memory_order_relaxed) == 0) return;
+			epoch.fetch_add(1, std::memory_order_seq_cst);
+			futex(FUTEX_WAKE_PRIVATE, count);
+		}
+
+		void futex(int op, int val, const timespec* timeout = nullptr) {
+			// the futex word is the integer wrapped by the atomic epoch
+			static_assert(sizeof(std::atomic<int>) == sizeof(int), "Unsupported atomic layout!");
+			syscall(SYS_futex, reinterpret_cast<int*>(&epoch), op, val, timeout, nullptr, 0);
+		}
+
+	};
+
+	/**
+	 * A binary semaphore blocking a single thread until it is signaled by another
+	 * thread. A kernel call is only conducted if the thread is actually blocked.
+	 */
+	class Parker {
+
+		// the states of the parker
+		static const int idle = 0;
+		static const int signaled = 1;
+		static const int parked = 2;
+
+		std::atomic<int> state;
+
+	public:
+
+		Parker() : state(idle) {}
+
+		Parker(const Parker&) = delete;
+		Parker(Parker&&) = delete;
+
+		Parker& operator=(const Parker&) = delete;
+		Parker& operator=(Parker&&) = delete;
+
+		/**
+		 * Blocks the calling thread until unpark is called, then resets the parker.
+		 * Returns immediately if unpark has been called already.
+		 */
+		void park() {
+			int cur = idle;
+			if (state.compare_exchange_strong(cur, parked, std::memory_order_acquire)) {
+				do {
+					futex(FUTEX_WAIT_PRIVATE, parked);
+				} while(state.load(std::memory_order_acquire) == parked);
+			}
+			state.store(idle, std::memory_order_relaxed);
+		}
+
+		/**
+		 * Releases the parked thread or the next call to park.
+		 */
+		void unpark() {
+			if (state.exchange(signaled, std::memory_order_release) == parked) {
+				futex(FUTEX_WAKE_PRIVATE, 1);
+			}
+		}
+
+	private:
+
+		void futex(int op, int val) {
+			static_assert(sizeof(std::atomic<int>) == sizeof(int), "Unsupported atomic layout!");
+			syscall(SYS_futex, reinterpret_cast<int*>(&state), op, val, nullptr, nullptr, 0);
+		}
+
+	};
+
 } // end namespace runtime
 } // end namespace utils
 } // end namespace parec
@@ -1,18 +1,36 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <cassert>
+#include <cstdint>
 #include <cstdlib>
+#include <functional>
+#include <initializer_list>
+#include <limits>
+#include <memory>
 #include <thread>
 #include <mutex>
 #include <vector>
-#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 #include <pthread.h>
 
 #include "parec/utils/functional_utils.h"
 #include "parec/utils/printer/arrays.h"
 
+#include "parec/utils/runtime/cancellation.h"
+#include "parec/utils/runtime/deque.h"
+#include "parec/utils/runtime/idle.h"
 #include "parec/utils/runtime/lock.h"
+#include "parec/utils/runtime/statistics.h"
+#include "parec/utils/runtime/topology.h"
+#include "parec/utils/runtime/trace.h"
 
 /**
  * This header provides a header-only implementation of a minimal
@@ -31,7 +49,7 @@ namespace runtime {
 		tl_worker = &worker;
 	}
 
-	static Worker& getCurrentWorker();
+	static Worker* getCurrentWorker();
 
 	// -----------------------------------------------------------------
 	//						   Immediate
@@ -48,7 +66,7 @@ namespace runtime {
 		Immediate() {}
 
 		Immediate(const T& value) : value(value) {}
-		Immediate(T&& value) : value(value) {}
+		Immediate(T&& value) : value(std::move(value)) {}
 
 		Immediate(const Immediate&) = delete;
 		Immediate(Immediate&& other) = default;
@@ -60,6 +78,10 @@ namespace runtime {
 			return true;
 		}
 
+		void wait() const {
+			// nothing
+		}
+
 		const T& get() const {
 			return value;
 		}
@@ -67,6 +89,14 @@ namespace runtime {
 		T&& extract() {
 			return std::move(value);
 		}
+
+		template<typename Fn>
+		void onReady(Fn&& fn) const {
+			fn();
+		}
+
+		template<typename Fn, typename R = decltype(std::declval<Fn&>()(std::declval<const T&>()))>
+		Immediate<R> then(Fn&& fn) const;
 	};
 
 	template<>
@@ -85,10 +115,22 @@ namespace runtime {
 			return true;
 		}
 
+		void wait() const {
+			// nothing
+		}
+
 		void get() const {
 			// nothing
 		}
 
+		template<typename Fn>
+		void onReady(Fn&& fn) const {
+			fn();
+		}
+
+		template<typename Fn, typename R = decltype(std::declval<Fn&>()())>
+		Immediate<R> then(Fn&& fn) const;
+
 	};
 
 	namespace detail {
@@ -123,732 +165,2938 @@ namespace runtime {
 		return detail::evaluator<Lambda,O>::process(lambda);
 	}
 
+	template<typename T>
+	template<typename Fn, typename R>
+	Immediate<R> Immediate<T>::then(Fn&& fn) const {
+		return evaluate([&]() { return fn(value); });
+	}
 
+	template<typename Fn, typename R>
+	Immediate<R> Immediate<void>::then(Fn&& fn) const {
+		return evaluate([&]() { return fn(); });
+	}
 
-	// -----------------------------------------------------------------
-	//						Future / Promise
-	// -----------------------------------------------------------------
-
-	template<typename T>
-	class Future;
+	/**
+	 * The sequential counterpart of when_all for immediate values.
+	 */
+	template<typename ... Ts>
+	Immediate<void> when_all(const Immediate<Ts>& ...) {
+		return Immediate<void>();
+	}
 
-	template<>
-	class Future<void>;
+	/**
+	 * The sequential counterpart of when_any for immediate values.
+	 */
+	template<typename ... Ts>
+	Immediate<std::size_t> when_any(const Immediate<Ts>& ...) {
+		return std::size_t(0);
+	}
 
-	template<typename T>
-	class Promise;
 
-	template<>
-	class Promise<void>;
 
-	template<typename T>
-	class FPLink;
+	// -----------------------------------------------------------------
+	//						  Object Pools
+	// -----------------------------------------------------------------
 
-	template<>
-	class FPLink<void>;
+	/**
+	 * A set of free lists for small objects, organized in size classes. Each worker
+	 * maintains its own pool, which must only be accessed by the worker itself.
+	 * Blocks released to a pool are retained for reuse up to a fixed number per
+	 * size class; all others are returned to the global allocator.
+	 */
+	class ObjectPool {
 
+	public:
 
-	template<typename T>
-	class FPLink {
+		// the granularity of the size classes
+		static const std::size_t granularity = 16;
 
-		friend class Future<T>;
+		// the maximum size of pooled objects
+		static const std::size_t max_object_size = 256;
 
-		friend class Promise<T>;
+	private:
 
-		int ref_counter;
+		// the maximum number of retained blocks per size class
+		static const std::size_t capacity = 1024;
 
-		T value;
+		static const std::size_t num_classes = max_object_size / granularity;
 
-		bool done;
+		struct Block {
+			Block* next;
+		};
 
-	private:
+		std::array<Block*,num_classes> heads;
 
-		FPLink() : ref_counter(1), done(false) {}
+		std::array<std::size_t,num_classes> sizes;
 
-		FPLink(const T& value)
-			: ref_counter(1), value(value), done(true) {}
+	public:
 
-		void incRef() {
-			ref_counter++;
+		ObjectPool() {
+			heads.fill(nullptr);
+			sizes.fill(0);
 		}
 
-		void decRef() {
-			ref_counter--;
-			if (ref_counter == 0) delete this;
-		}
+		ObjectPool(const ObjectPool&) = delete;
+		ObjectPool(ObjectPool&&) = delete;
 
-		bool isDone() const { return done; }
+		ObjectPool& operator=(const ObjectPool&) = delete;
+		ObjectPool& operator=(ObjectPool&&) = delete;
 
-		void setValue(const T& value) {
-			this->value = value;
-			done = true;
+		~ObjectPool() {
+			for(auto& head : heads) {
+				while(head) {
+					Block* cur = head;
+					head = head->next;
+					::operator delete(cur);
+				}
+			}
 		}
 
-		const T& getValue() const {
-			return value;
+		/**
+		 * Obtains the number of retained blocks of the size class of the given size.
+		 */
+		std::size_t getSize(std::size_t size) const {
+			return (size <= max_object_size) ? sizes[getClass(size)] : 0;
 		}
 
-	};
+		void* allocate(std::size_t size) {
+			if (size > max_object_size) return ::operator new(size);
+			auto c = getClass(size);
+			Block* res = heads[c];
+			if (!res) return ::operator new(getBlockSize(size));
+			heads[c] = res->next;
+			--sizes[c];
+			return res;
+		}
 
-	template<typename T>
-	class Future {
+		void deallocate(void* ptr, std::size_t size) {
+			if (size > max_object_size) {
+				::operator delete(ptr);
+				return;
+			}
+			auto c = getClass(size);
+			if (sizes[c] >= capacity) {
+				::operator delete(ptr);
+				return;
+			}
+			Block* block = static_cast<Block*>(ptr);
+			block->next = heads[c];
+			heads[c] = block;
+			++sizes[c];
+		}
 
-		friend class Promise<T>;
+		/**
+		 * Allocates memory for an object of the given size from the pool of the current
+		 * worker or, if called by some other thread, the global allocator.
+		 */
+		static void* allocateLocal(std::size_t size);
 
-		FPLink<T>* link;
+		/**
+		 * Releases memory obtained through allocateLocal to the pool of the current worker
+		 * or, if called by some other thread, the global allocator.
+		 */
+		static void deallocateLocal(void* ptr, std::size_t size);
 
-		Future(FPLink<T>* link) : link(link) {
-			link->incRef();
+		/**
+		 * Obtains the size of the blocks allocated for objects of the given size. Blocks
+		 * may be released to a different pool than the one they have been obtained from.
+		 */
+		static std::size_t getBlockSize(std::size_t size) {
+			return (size > max_object_size) ? size : (getClass(size) + 1) * granularity;
 		}
 
-	public:
+	private:
 
-		Future() : link(nullptr) {}
+		static std::size_t getClass(std::size_t size) {
+			return (size == 0) ? 0 : (size - 1) / granularity;
+		}
 
-		Future(const T& res) : link(new FPLink<T>(res)) {}
+	};
 
-		Future(const Future&) = delete;
+	/**
+	 * A base for types to be allocated through the object pools of the workers.
+	 */
+	struct Pooled {
 
-		Future(Future&& other) : link(other.link) {
-			other.link = nullptr;
+		static void* operator new(std::size_t size) {
+			return ObjectPool::allocateLocal(size);
 		}
 
-		~Future() {
-			if (link) link->decRef();
+		static void operator delete(void* ptr, std::size_t size) {
+			ObjectPool::deallocateLocal(ptr, size);
 		}
 
-		Future& operator=(const Future&) = delete;
+	};
 
-		Future& operator=(Future&& other) {
-			if (link == other.link) return *this;
-			if (link) link->decRef();
-			link = other.link;
-			other.link = nullptr;
-			return *this;
-		}
 
-		bool isDone() const {
-			return !link || link->isDone();
-		}
+	// -----------------------------------------------------------------
+	//						Future / Promise
+	// -----------------------------------------------------------------
 
-		inline const T& get() const;
+	/*
+	 * Two implementations of futures and promises are provided. By default, they share a
+	 * reference-counted state allocated from the object pools (FPLink). If
+	 * PAREC_INLINE_FUTURES is defined before including the runtime, results are stored in
+	 * the futures themselves instead (see future_base). Both offer the same interface,
+	 * apart from promises not being copyable in the latter.
+	 */
+
+	/**
+	 * An operation to be conducted once some future is ready.
+	 */
+	struct Continuation : public Pooled {
+
+		Continuation* next = nullptr;
+
+		virtual ~Continuation() {}
+
+		virtual void run() = 0;
 
-		T&& extract();
 	};
 
+	/**
+	 * The completion state of a future, including the list of its pending continuations.
+	 * Continuations are run by the thread completing the future or, if already completed,
+	 * by the thread registering them.
+	 */
+	class CompletionState {
 
-	template<typename T>
-	class Promise {
+		// the pending state without continuations
+		static const std::uintptr_t pending = 0;
 
-		FPLink<T>* link;
+		// the completed state
+		static const std::uintptr_t completed = 1;
+
+		// one of the states above or the list of pending continuations, newest first
+		std::atomic<std::uintptr_t> state;
 
 	public:
 
-		Promise() : link(new FPLink<T>()) {}
+		CompletionState(bool done) : state(done ? completed : pending) {}
 
-		Promise(const Promise& other) : link(other.link) {
-			link->incRef();
-		}
+		CompletionState(const CompletionState&) = delete;
+		CompletionState& operator=(const CompletionState&) = delete;
 
-		Promise(Promise& other) : link(other.link) {
-			other.link = nullptr;
+		~CompletionState() {
+			// continuations of never completed futures are dropped
+			auto cur = state.load(std::memory_order_relaxed);
+			if (cur == pending || cur == completed) return;
+			for(Continuation* c = reinterpret_cast<Continuation*>(cur); c; ) {
+				Continuation* next = c->next;
+				delete c;
+				c = next;
+			}
 		}
 
-		~Promise() {
-			if (link) link->decRef();
+		bool isDone() const {
+			return state.load(std::memory_order_acquire) == completed;
 		}
 
-		Promise* operator()(const Promise& other) = delete;
-		Promise* operator()(Promise&& other) = delete;
+		/**
+		 * Marks the future as completed and runs all registered continuations.
+		 */
+		void setDone() {
+			auto cur = state.exchange(completed, std::memory_order_acq_rel);
+			if (cur == pending) return;
+
+			// reverse the list to run continuations in the order of their registration
+			Continuation* list = nullptr;
+			for(Continuation* c = reinterpret_cast<Continuation*>(cur); c; ) {
+				Continuation* next = c->next;
+				c->next = list;
+				list = c;
+				c = next;
+			}
 
-		Future<T> getFuture() {
-			return Future<T>(link);
+			// run continuations
+			while(list) {
+				Continuation* next = list->next;
+				list->run();
+				delete list;
+				list = next;
+			}
 		}
 
-		void set(const T& res) {
-			link->setValue(res);
+		/**
+		 * Registers a continuation, which is run immediately if the future is completed.
+		 */
+		void addContinuation(Continuation* c) {
+			auto cur = state.load(std::memory_order_acquire);
+			while(cur != completed) {
+				c->next = (cur == pending) ? nullptr : reinterpret_cast<Continuation*>(cur);
+				if (state.compare_exchange_weak(cur, reinterpret_cast<std::uintptr_t>(c), std::memory_order_release, std::memory_order_acquire)) return;
+			}
+			c->run();
+			delete c;
 		}
 
 	};
 
+	namespace detail {
 
-	// - void specialization -
+		template<typename Fn>
+		struct continuation : public Continuation {
 
-	template<>
-	class FPLink<void> {
+			Fn fn;
 
-		friend class Future<void>;
+			template<typename F>
+			continuation(F&& fn) : fn(std::forward<F>(fn)) {}
 
-		friend class Promise<void>;
+			void run() override {
+				fn();
+			}
 
-		std::atomic<int> ref_counter;
+		};
 
-		bool done;
+		template<typename Fn>
+		Continuation* makeContinuation(Fn&& fn) {
+			return new continuation<typename std::decay<Fn>::type>(std::forward<Fn>(fn));
+		}
 
-	private:
+	}
 
-		FPLink(bool done = false) : ref_counter(1), done(done) {}
+	template<typename T>
+	class Future;
 
-		void incRef() {
-			ref_counter++;
-		}
+	template<>
+	class Future<void>;
 
-		void decRef() {
-			auto precount = ref_counter.fetch_sub(1);
-			if (precount == 1) delete this;
-		}
+	template<typename T>
+	class Promise;
 
-		bool isDone() const { return done; }
+	template<>
+	class Promise<void>;
 
-	};
+	template<typename T>
+	class FPLink;
 
 	template<>
-	class Future<void> {
+	class FPLink<void>;
 
-		template<typename T>
-		friend class Promise;
 
-		FPLink<void>* link;
+#ifdef PAREC_INLINE_FUTURES
 
-		Future(FPLink<void>* link) : link(link) {
-			link->incRef();
-		}
+	/**
+	 * Futures and promises linked without a shared state: the result is stored in the
+	 * future itself and the promise tracks the future's address through moves. Thus,
+	 * spawning a task involves no allocation besides the task frame. The link is guarded
+	 * by a lock in each of the two ends; futures lock their own end first, promises try
+	 * to lock the future's end while holding their own and back off if that fails.
+	 *
+	 * Continuations are kept by the promise, since they have to outlive the future.
+	 * Unlike the shared-state design, a future may only be obtained once from a promise,
+	 * and promises can not be copied.
+	 */
 
-	public:
+	namespace detail {
 
-		Future() : link(nullptr) {}
+		/**
+		 * The outcome of an operation, a value or an exception.
+		 */
+		template<typename T>
+		struct result {
 
-		Future(const Future&) = delete;
+			T value;
 
-		Future(Future&& other) : link(other.link) {
-			other.link = nullptr;
-		}
+			std::exception_ptr error;
 
-		~Future() {
-			if (link) link->decRef();
-		}
+		};
 
-		Future& operator=(const Future&) = delete;
+		template<>
+		struct result<void> {
 
-		Future& operator=(Future&& other) {
-			if (link == other.link) return *this;
-			if (link) link->decRef();
-			link = other.link;
-			other.link = nullptr;
-			return *this;
-		}
+			std::exception_ptr error;
 
-		bool isDone() const {
-			return !link || link->isDone();
-		}
+		};
 
-		void get() const;
+		/**
+		 * An operation to be conducted with the outcome of a future once it is ready.
+		 */
+		template<typename T>
+		struct result_continuation : public Pooled {
 
-	};
+			result_continuation* next = nullptr;
 
+			// whether the operation reads the value, which then has to be kept for it
+			bool inspects = true;
 
-	template<>
-	class Promise<void> {
+			virtual ~result_continuation() {}
 
-		FPLink<void>* link;
+			virtual void run(result<T>& res) = 0;
 
-	public:
+		};
 
-		Promise() : link(new FPLink<void>()) {}
+		template<typename T, typename Fn>
+		struct result_continuation_impl : public result_continuation<T> {
 
-		Promise(const Promise& other) : link(other.link) {
-			link->incRef();
-		}
+			Fn fn;
 
-		Promise(Promise& other) : link(other.link) {
-			other.link = nullptr;
-		}
+			template<typename F>
+			result_continuation_impl(F&& fn) : fn(std::forward<F>(fn)) {}
 
-		~Promise() {
-			if (link) link->decRef();
-		}
+			void run(result<T>& res) override {
+				fn(res);
+			}
 
-		Promise* operator()(const Promise& other) = delete;
-		Promise* operator()(Promise&& other) = delete;
+		};
 
-		Future<void> getFuture() {
-			return Future<void>(link);
+		/**
+		 * Moves the outcome of an operation to a future, or copies it if continuations
+		 * still have to inspect it. Move-only values are always moved.
+		 */
+		template<typename T>
+		void transfer(result<T>& dst, result<T>& src, bool keep, std::true_type) {
+			if (keep) {
+				dst = src;
+			} else {
+				dst = std::move(src);
+			}
 		}
 
-		void set() {
-			link->done = true;
+		template<typename T>
+		void transfer(result<T>& dst, result<T>& src, bool, std::false_type) {
+			dst = std::move(src);
 		}
 
-	};
+		template<typename T>
+		struct is_copyable_result : public std::is_copy_constructible<T> {};
 
+		template<>
+		struct is_copyable_result<void> : public std::true_type {
 
+		};
 
-	// -----------------------------------------------------------------
-	//						    Worker Pool
-	// -----------------------------------------------------------------
+		template<typename T>
+		class promise_base;
 
-	using Task = std::function<void()>;
+		/**
+		 * The part of a future maintaining the link to its promise.
+		 */
+		template<typename T>
+		class future_base {
 
+			friend class promise_base<T>;
 
-	template<typename T, size_t size>
-	class SimpleQueue {
+			// the producing promise, null once the result is available or the promise is gone
+			promise_base<T>* promise;
 
-		static const int bsize = size + 1;
+			// guards this end of the link
+			mutable SpinLock lock;
 
-		SpinLock lock;
+			// set once the result is available
+			std::atomic<bool> ready;
 
-		std::array<T,bsize> data;
+		protected:
 
-		size_t front;
-		size_t back;
+			result<T> res;
 
-	public:
+			future_base() : promise(nullptr), ready(true) {}
 
-		SimpleQueue() : lock(), front(0), back(0) {
-			for(auto& cur : data) cur = 0;
-		}
+			future_base(promise_base<T>& promise) : promise(nullptr), ready(false) {
+				promise.attach(*this);
+			}
 
-		bool empty() const {
-			return front == back;
-		}
-		bool full() const {
-			return ((back + 1) % bsize) == front;
-		}
+			future_base(future_base&& other) : promise(nullptr), ready(true) {
+				take(other);
+			}
 
-		bool push_front(const T& t) {
-			lock.lock();
-			if (full()) {
-				lock.unlock();
-				return false;
+			~future_base() {
+				detach();
 			}
-			front = (front - 1 + bsize) % bsize;
-			data[front] = t;
-			lock.unlock();
-			return true;
-		}
 
-		bool push_back(const T& t) {
-			lock.lock();
-			if (full()) {
-				lock.unlock();
-				return false;
+			future_base& operator=(future_base&& other) {
+				if (this == &other) return *this;
+				detach();
+				take(other);
+				return *this;
 			}
-			data[back] = t;
-			back = (back + 1) % bsize;
-			lock.unlock();
-			return true;
-		}
 
-		T pop_front() {
-			lock.lock();
-			if (empty()) {
-				lock.unlock();
-				return 0;
+		public:
+
+			bool isDone() const {
+				return ready.load(std::memory_order_acquire);
 			}
-			T res = data[front];
-			front = (front + 1) % bsize;
-			lock.unlock();
-			return res;
-		}
 
-		T pop_back() {
-			lock.lock();
-			if (empty()) {
-				lock.unlock();
-				return 0;
+			/**
+			 * Registers an operation to be run once this future is ready. The operation is
+			 * run by the thread completing the future -- or immediately, if it is ready --
+			 * and should thus be short. Use then() for scheduling follow-up work.
+			 */
+			template<typename Fn>
+			void onReady(Fn&& fn) const {
+				onCompletion([fn=std::forward<Fn>(fn)](const result<T>&) mutable { fn(); }, false);
 			}
-			back = (back - 1 + bsize) % bsize;
-			T res = data[back];
-			lock.unlock();
-			return res;
-		}
 
-		friend std::ostream& operator<<(std::ostream& out, const SimpleQueue& queue) {
-			return out << "[" << queue.data << "," << queue.front << " - " << queue.back << "]";
-		}
+		protected:
+
+			/**
+			 * Registers an operation to be called with the outcome of this future once it
+			 * is ready. The operation is retained even if this future is destroyed before.
+			 * Operations not inspecting the value may be called after it has been moved on.
+			 */
+			template<typename Fn>
+			void onCompletion(Fn&& fn, bool inspects = true) const {
+				if (!isDone()) {
+					lock.lock();
+					if (promise_base<T>* p = promise) {
+						p->lock.lock();
+						lock.unlock();
+						auto c = new result_continuation_impl<T,typename std::decay<Fn>::type>(std::forward<Fn>(fn));
+						c->inspects = inspects;
+						p->addContinuation(c);
+						p->lock.unlock();
+						return;
+					}
+					bool done = ready.load(std::memory_order_relaxed);
+					lock.unlock();
+					// futures of abandoned promises never get ready
+					if (!done) return;
+				}
+				// operations consuming the value (see forward) are only registered on expiring futures
+				fn(const_cast<result<T>&>(res));
+			}
 
-	};
+		private:
 
-	namespace detail {
+			void detach() {
+				if (isDone()) return;
+				lock.lock();
+				if (promise_base<T>* p = promise) {
+					p->lock.lock();
+					p->future = nullptr;
+					promise = nullptr;
+					p->lock.unlock();
+				}
+				lock.unlock();
+			}
+
+			void take(future_base& other) {
+				if (other.isDone()) {
+					res = std::move(other.res);
+					ready.store(true, std::memory_order_relaxed);
+					return;
+				}
+				other.lock.lock();
+				if (promise_base<T>* p = other.promise) {
+					// migrate the link to the promise
+					p->lock.lock();
+					ready.store(false, std::memory_order_relaxed);
+					promise = p;
+					p->future = this;
+					other.promise = nullptr;
+					p->lock.unlock();
+				} else {
+					res = std::move(other.res);
+					ready.store(other.ready.load(std::memory_order_relaxed), std::memory_order_relaxed);
+				}
+				other.ready.store(true, std::memory_order_relaxed);
+				other.lock.unlock();
+			}
+
+		};
 
 		/**
-		 * A utility to fix the affinity of the current thread to the given core.
+		 * The part of a promise maintaining the link to its future.
 		 */
-		inline void fixAffinity(int core) {
-			static const int num_cores = std::thread::hardware_concurrency();
-			cpu_set_t mask;
-			CPU_ZERO(&mask);
-			CPU_SET(core % num_cores, &mask);
-			pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &mask);
-		}
+		template<typename T>
+		class promise_base {
 
-	}
+			friend class future_base<T>;
 
-	class WorkerPool;
+			// the future to be informed, if any
+			future_base<T>* future;
 
-	struct Worker {
+			// guards this end of the link
+			SpinLock lock;
 
-		WorkerPool& pool;
+			// set once the outcome is available
+			bool done;
 
-		volatile bool alive;
+			// the continuations to be run on completion, newest first
+			result_continuation<T>* continuations;
 
-		SimpleQueue<Task*,8> queue;
+		protected:
 
-		std::thread thread;
+			result<T> res;
 
-		unsigned id;
+			promise_base() : future(nullptr), done(false), continuations(nullptr) {}
 
-		unsigned random_seed;
+			promise_base(promise_base&& other) : future(nullptr), done(other.done), continuations(nullptr) {
+				future_base<T>* f = other.lockFuture();
+				res = std::move(other.res);
+				continuations = other.continuations;
+				other.continuations = nullptr;
 
-	public:
+				// the new promise is published by the migration of the link
+				if (f) {
+					f->promise = this;
+					future = f;
+					other.future = nullptr;
+					f->lock.unlock();
+				}
 
-		Worker(WorkerPool& pool, unsigned id)
-			: pool(pool), alive(true), id(id), random_seed(id) { }
+				// moved-from promises are inert
+				other.done = true;
+				other.lock.unlock();
+			}
 
-		Worker(const Worker&) = delete;
-		Worker(Worker&&) = delete;
+			~promise_base() {
+				if (done) return;
 
-		Worker& operator=(const Worker&) = delete;
-		Worker& operator=(Worker&&) = delete;
+				// the future of an abandoned promise never gets ready
+				future_base<T>* f = lockFuture();
+				if (f) {
+					f->promise = nullptr;
+					f->lock.unlock();
+				}
+				future = nullptr;
+				result_continuation<T>* list = continuations;
+				continuations = nullptr;
+				lock.unlock();
 
-		void start() {
-			thread = std::thread([&](){ run(); });
-		}
+				while(list) {
+					auto next = list->next;
+					delete list;
+					list = next;
+				}
+			}
 
-		void poison() {
-			alive = false;
-		}
+			/**
+			 * Locks this promise and its future, if there is any.
+			 */
+			future_base<T>* lockFuture() {
+				while(true) {
+					lock.lock();
+					future_base<T>* f = future;
+					if (!f || f->lock.try_lock()) return f;
+					lock.unlock();
+					cpu_relax();
+				}
+			}
 
-		void join() {
-			thread.join();
-		}
+			/**
+			 * Delivers the outcome stored in this promise to the given future locked by
+			 * lockFuture, and runs the registered continuations.
+			 */
+			void complete(future_base<T>* f) {
+				done = true;
+				if (f) {
+					// the value is moved to the future unless continuations have to inspect it
+					bool keep = false;
+					for(auto cur = continuations; cur; cur = cur->next) {
+						keep = keep || cur->inspects;
+					}
+					transfer(f->res, res, keep, is_copyable_result<T>());
+					f->promise = nullptr;
+					f->ready.store(true, std::memory_order_release);
+					f->lock.unlock();
+					future = nullptr;
+				}
+				result_continuation<T>* cur = continuations;
+				continuations = nullptr;
+				lock.unlock();
 
-	private:
+				// reverse the list to run continuations in the order of their registration
+				result_continuation<T>* list = nullptr;
+				while(cur) {
+					auto next = cur->next;
+					cur->next = list;
+					list = cur;
+					cur = next;
+				}
+				while(list) {
+					auto next = list->next;
+					list->run(res);
+					delete list;
+					list = next;
+				}
+			}
 
-		void run();
+		public:
 
-	public:
+			void setException(std::exception_ptr error) {
+				auto f = lockFuture();
+				res.error = error;
+				complete(f);
+			}
 
-		bool schedule_step();
+		private:
 
-	};
+			void attach(future_base<T>& f) {
+				std::lock_guard<SpinLock> g(lock);
+				if (done) {
+					// the continuations have been processed, the outcome may be moved on
+					f.res = std::move(res);
+					f.ready.store(true, std::memory_order_relaxed);
+					return;
+				}
+				assert(!future && "Future has already been obtained!");
+				future = &f;
+				f.promise = this;
+			}
 
+			void addContinuation(result_continuation<T>* c) {
+				c->next = continuations;
+				continuations = c;
+			}
 
+		};
 
+	}
 
-	class WorkerPool {
+	template<typename T>
+	class Future : public detail::future_base<T> {
 
-		std::vector<Worker*> workers;
+		friend class Promise<T>;
 
-		// tools for managing idle threads
-		std::mutex m;
-		std::condition_variable cv;
+		Future(Promise<T>& promise) : detail::future_base<T>(promise) {}
 
-		WorkerPool() {
+	public:
 
-			int numWorkers = std::thread::hardware_concurrency();
+		Future() {}
 
-			// parse environment variable
-			if (char* val = std::getenv("NUM_WORKERS")) {
-				auto userDef = std::atoi(val);
-				if (userDef != 0) numWorkers = userDef;
-			}
+		Future(const T& value) {
+			this->res.value = value;
+		}
 
-			// must be at least one
-			if (numWorkers < 1) numWorkers = 1;
+		Future(T&& value) {
+			this->res.value = std::move(value);
+		}
 
-			// subtract main thread
-			numWorkers = numWorkers - 1;
+		Future(const Future&) = delete;
 
-			// create workers
-			for(int i=0; i<numWorkers; ++i) {
-				workers.push_back(new Worker(*this, i+1));
-			}
+		Future(Future&& other) = default;
 
-			// start workers
-			for(auto& cur : workers) cur->start();
+		Future& operator=(const Future&) = delete;
 
-			// fix affinity of main thread
-			detail::fixAffinity(0);
-		}
+		Future& operator=(Future&& other) = default;
 
-		~WorkerPool() {
-			// shutdown threads
+		/**
+		 * Waits for this future to be ready without retrieving its value.
+		 */
+		void wait() const;
 
-			// poison all workers
-			for(auto& cur : workers) {
-				cur->poison();
-			}
+		/**
+		 * Obtains the value of this future, waiting for it if necessary. If the computation
+		 * of the value failed, the exception raised by it is rethrown; if it has been
+		 * abandoned due to a cancellation, operation_cancelled is thrown.
+		 */
+		inline const T& get() const;
 
-			// signal new work
-			workAvailable();
+		T&& extract();
 
-			// wait for their death
-			for(auto& cur : workers) {
-				cur->join();
-			}
+		/**
+		 * Schedules the given operation as a new task once this future is ready. The
+		 * operation is called with the value of this future; its result is provided
+		 * through the returned future.
+		 */
+		template<typename Fn, typename R = decltype(std::declval<Fn&>()(std::declval<const T&>()))>
+		Future<R> then(Fn&& fn) const;
 
-			// free resources
-			for(auto& cur : workers) {
-				delete cur;
-			}
+	};
 
-		}
+	template<typename T>
+	class Promise : public detail::promise_base<T> {
 
 	public:
 
-		static WorkerPool& getInstance() {
-			static WorkerPool pool;
-			return pool;
-		}
+		Promise() {}
 
-		int getNumWorkers() const {
-			return workers.size();
+		Promise(const Promise& other) = delete;
+
+		// copies of non-const promises (e.g. captured by tasks) take over the link
+		Promise(Promise& other) : detail::promise_base<T>(std::move(other)) {}
+
+		Promise(Promise&& other) = default;
+
+		Promise* operator()(const Promise& other) = delete;
+		Promise* operator()(Promise&& other) = delete;
+
+		Future<T> getFuture() {
+			return Future<T>(*this);
 		}
 
-		Worker& getWorker(int i) {
-			return *workers[i];
+		void set(const T& value) {
+			auto f = this->lockFuture();
+			this->res.value = value;
+			this->complete(f);
 		}
 
-		Worker& getWorker() {
-			static int counter = 0;
-			return getWorker((++counter) % workers.size());
+		void set(T&& value) {
+			auto f = this->lockFuture();
+			this->res.value = std::move(value);
+			this->complete(f);
 		}
 
-	protected:
+		/**
+		 * Completes the associated future with the outcome of the given future once it
+		 * is ready, without waiting for it. The given future is consumed, its value is
+		 * moved on.
+		 */
+		void forward(Future<T>&& future) {
+			Future<T> src = std::move(future);
+			src.onCompletion([p=std::move(*this)](detail::result<T>& res) mutable {
+				if (res.error) {
+					p.setException(res.error);
+				} else {
+					p.set(std::move(res.value));
+				}
+			});
+		}
 
-		friend Worker;
+	};
 
-		void waitForWork() {
-			std::unique_lock<std::mutex> lk(m);
-			cv.wait(lk);
-		}
 
-		void workAvailable() {
-			// wake up all workers
-			cv.notify_all();
-		}
+	// - void specialization -
 
-	private:
+	template<>
+	class Future<void> : public detail::future_base<void> {
 
-		template<typename LambdaSeq, typename LambdaPar, typename R>
-		struct runner {
-			Future<R> operator()(Worker& worker, const LambdaSeq& seq, const LambdaPar& par) {
+		template<typename T>
+		friend class Promise;
 
-				// if the queue is full, process task immediately
-				if (worker.queue.full()) {
-					return seq();  // run task and be happy
-				}
+		Future(Promise<void>& promise);
 
-				// create a schedulable task
-				Promise<R> p;
-				auto res = p.getFuture();
-				Task* t = new Task([=]() mutable {
-					p.set(par());
-				});
+	public:
 
-				// schedule task
-				bool succ = worker.queue.push_front(t);
-				if (!succ) {
-					delete t;
-					return seq();
-				}
+		Future() {}
 
-				// return future
-				return res;
-			}
-		};
+		Future(const Future&) = delete;
 
-		template<typename LambdaSeq, typename LambdaPar>
-		struct runner<LambdaSeq,LambdaPar,void> {
-			Future<void> operator()(Worker& worker, const LambdaSeq& seq, const LambdaPar& par) {
+		Future(Future&& other) = default;
 
-				// if the queue is full, process task immediately
-				if (worker.queue.full()) {
-					seq();			// run task and be happy
-					return Future<void>();
-				}
+		Future& operator=(const Future&) = delete;
 
-				// create a schedulable task
-				Promise<void> p;
-				auto res = p.getFuture();
-				Task* t = new Task([=]() mutable {
-					par();
-					p.set();
-				});
+		Future& operator=(Future&& other) = default;
 
-				// schedule task
-				bool succ = worker.queue.push_front(t);
-				if (!succ) {
-					delete t;
-					seq();
-					return Future<void>();
-				}
+		void wait() const;
 
-				// return future
-				return res;
+		void get() const;
 
-			}
-		};
+		/**
+		 * Schedules the given operation as a new task once this future is ready. The
+		 * result of the operation is provided through the returned future.
+		 */
+		template<typename Fn, typename R = decltype(std::declval<Fn&>()())>
+		Future<R> then(Fn&& fn) const;
 
-		template<typename LambdaSeq, typename R>
-		struct direct_runner {
-			Future<R> operator()(const LambdaSeq& seq) {
-				return seq();
-			}
-		};
+	};
 
-		template<typename LambdaSeq>
-		struct direct_runner<LambdaSeq,void> {
-			Future<void> operator()(const LambdaSeq& seq) {
-				seq();
-				return Future<void>();
-			}
-		};
+	template<>
+	class Promise<void> : public detail::promise_base<void> {
 
 	public:
 
-		template<typename LambdaSeq, typename LambdaPar, typename R>
-		Future<R> spawn(const LambdaSeq& seq, const LambdaPar& par) {
+		Promise() {}
 
-			// check whether there are any workers
-			if (getNumWorkers() == 0) {
-				// process directly
-				return direct_runner<LambdaSeq,R>()(seq);
-			}
+		Promise(const Promise& other) = delete;
 
-			// get current worker
-			auto& worker = getCurrentWorker();
+		Promise(Promise& other) : detail::promise_base<void>(std::move(other)) {}
 
-			// run task
-			auto res = runner<LambdaSeq,LambdaPar,R>()(worker, seq, par);
+		Promise(Promise&& other) = default;
 
-			// make worker aware of new work
-			workAvailable();
+		Promise* operator()(const Promise& other) = delete;
+		Promise* operator()(Promise&& other) = delete;
 
-			// return future
-			return res;
+		Future<void> getFuture() {
+			return Future<void>(*this);
 		}
 
-	};
-
-	template<typename T>
-	const T& Future<T>::get() const {
-		while (!isDone()) {
-			// process another task
-			getCurrentWorker().schedule_step();
+		void set() {
+			auto f = lockFuture();
+			complete(f);
 		}
-		return link->getValue();
-	}
 
-	template<typename T>
-	T&& Future<T>::extract() {
-		while (!isDone()) {
-			// process another task
-			getCurrentWorker().schedule_step();
+		void forward(Future<void>&& future) {
+			future.onCompletion([p=std::move(*this)](const detail::result<void>& res) mutable {
+				if (res.error) {
+					p.setException(res.error);
+				} else {
+					p.set();
+				}
+			});
 		}
-		return std::move(const_cast<T&>(link->getValue()));
-	}
 
-	inline void Future<void>::get() const {
-		while (!isDone()) {
-			// process another task
-			getCurrentWorker().schedule_step();
-		}
-	}
+	};
 
-	inline void Worker::run() {
+	inline Future<void>::Future(Promise<void>& promise) : detail::future_base<void>(promise) {}
 
-		// fix affinity
-		detail::fixAffinity(id);
+#else
 
-		// register worker
-		setCurrentWorker(*this);
+	/**
+	 * The state shared between a promise and its futures. The reference counter
+	 * is atomic since futures and promises are released by different threads, and
+	 * the completion flag publishes the result with release/acquire semantics.
+	 */
+	template<typename T>
+	class FPLink : public Pooled {
 
-		// TODO: idle time handling
+		friend class Future<T>;
 
-		// start processing loop
-		while(alive) {
+		friend class Promise<T>;
 
-			// count number of idle cycles
-			int idle_cycles = 0;
+		std::atomic<int> ref_counter;
 
-			// conduct a schedule step
-			while (alive && !schedule_step()) {
-				// increment idle counter
-				++idle_cycles;
+		T value;
 
-				// wait a moment
-				cpu_relax();
+		// the exception raised while computing the value, if any
+		std::exception_ptr error;
 
-				// if there was no work for quite some time
-				if (idle_cycles > 1000) {
+		CompletionState state;
 
-					// wait for work
-					pool.waitForWork();
+	private:
 
-					// reset cycle counter
-					idle_cycles = 0;
+		FPLink() : ref_counter(1), state(false) {}
 
-				}
+		FPLink(const T& value)
+			: ref_counter(1), value(value), state(true) {}
+
+		FPLink(T&& value)
+			: ref_counter(1), value(std::move(value)), state(true) {}
+
+		void incRef() {
+			// a sole owner can not race with anybody else
+			if (ref_counter.load(std::memory_order_relaxed) == 1) {
+				ref_counter.store(2, std::memory_order_relaxed);
+			} else {
+				ref_counter.fetch_add(1, std::memory_order_relaxed);
 			}
 		}
 
-		// done
-
-	}
+		void decRef() {
+			// a sole owner can not race with anybody else
+			if (ref_counter.load(std::memory_order_acquire) == 1 || ref_counter.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				delete this;
+			}
+		}
 
-	inline bool Worker::schedule_step() {
+		bool isDone() const {
+			return state.isDone();
+		}
 
-		// process a task from the local queue
-		if (Task* t = queue.pop_back()) {
-			t->operator()();
-			delete t;
-			return true;
+		void setValue(const T& value) {
+			this->value = value;
+			state.setDone();
 		}
 
-		// check that there are other workers
-		int numWorker = pool.getNumWorkers();
-		if (numWorker <= 1) return false;
+		void setValue(T&& value) {
+			this->value = std::move(value);
+			state.setDone();
+		}
 
-		// otherwise, steal a task from another worker
-		Worker& other = pool.getWorker(rand_r(&random_seed) % numWorker);
-		if (this == &other) {
-			return schedule_step();
+		void setError(std::exception_ptr error) {
+			this->error = error;
+			state.setDone();
 		}
 
-		if (Task* t = other.queue.pop_front()) {
-			t->operator()();
-			delete t;
-			return true;
+		const T& getValue() const {
+			if (error) std::rethrow_exception(error);
+			return value;
 		}
 
-		// no task found => wait a moment
-		return false;
-	}
+	};
 
+	template<typename T>
+	class Future {
 
-	static Worker& getCurrentWorker() {
-		if (tl_worker) return *tl_worker;
-		return WorkerPool::getInstance().getWorker();
-	}
+		friend class Promise<T>;
 
-	template<
-		typename LambdaSeq,
-		typename LambdaPar,
-		typename R = typename std::enable_if<
-			std::is_same<
-				typename lambda_traits<LambdaSeq>::result_type,
-				typename lambda_traits<LambdaPar>::result_type
-			>::value,
-			typename lambda_traits<LambdaSeq>::result_type
-		>::type
-	>
-	Future<R> spawn(const LambdaSeq& seq, const LambdaPar& par) {
-		return WorkerPool::getInstance().spawn<LambdaSeq,LambdaPar,R>(seq,par);
-	}
+		FPLink<T>* link;
 
-	template<
+		Future(FPLink<T>* link) : link(link) {
+			link->incRef();
+		}
+
+	public:
+
+		Future() : link(nullptr) {}
+
+		Future(const T& res) : link(new FPLink<T>(res)) {}
+
+		Future(T&& res) : link(new FPLink<T>(std::move(res))) {}
+
+		Future(const Future&) = delete;
+
+		Future(Future&& other) : link(other.link) {
+			other.link = nullptr;
+		}
+
+		~Future() {
+			if (link) link->decRef();
+		}
+
+		Future& operator=(const Future&) = delete;
+
+		Future& operator=(Future&& other) {
+			if (link == other.link) return *this;
+			if (link) link->decRef();
+			link = other.link;
+			other.link = nullptr;
+			return *this;
+		}
+
+		bool isDone() const {
+			return !link || link->isDone();
+		}
+
+		/**
+		 * Waits for this future to be ready without retrieving its value.
+		 */
+		void wait() const;
+
+		/**
+		 * Obtains the value of this future, waiting for it if necessary. If the computation
+		 * of the value failed, the exception raised by it is rethrown; if it has been
+		 * abandoned due to a cancellation, operation_cancelled is thrown.
+		 */
+		inline const T& get() const;
+
+		T&& extract();
+
+		/**
+		 * Registers an operation to be run once this future is ready. The operation is
+		 * run by the thread completing the future -- or immediately, if it is ready --
+		 * and should thus be short. Use then() for scheduling follow-up work.
+		 */
+		template<typename Fn>
+		void onReady(Fn&& fn) const {
+			if (isDone()) {
+				fn();
+				return;
+			}
+			link->state.addContinuation(detail::makeContinuation(std::forward<Fn>(fn)));
+		}
+
+		/**
+		 * Schedules the given operation as a new task once this future is ready. The
+		 * operation is called with the value of this future; its result is provided
+		 * through the returned future.
+		 */
+		template<typename Fn, typename R = decltype(std::declval<Fn&>()(std::declval<const T&>()))>
+		Future<R> then(Fn&& fn) const;
+	};
+
+
+	template<typename T>
+	class Promise {
+
+		FPLink<T>* link;
+
+	public:
+
+		Promise() : link(new FPLink<T>()) {}
+
+		Promise(const Promise& other) : link(other.link) {
+			link->incRef();
+		}
+
+		Promise(Promise& other) : link(other.link) {
+			other.link = nullptr;
+		}
+
+		Promise(Promise&& other) : link(other.link) {
+			other.link = nullptr;
+		}
+
+		~Promise() {
+			if (link) link->decRef();
+		}
+
+		Promise* operator()(const Promise& other) = delete;
+		Promise* operator()(Promise&& other) = delete;
+
+		Future<T> getFuture() {
+			return Future<T>(link);
+		}
+
+		void set(const T& res) {
+			link->setValue(res);
+		}
+
+		void set(T&& res) {
+			link->setValue(std::move(res));
+		}
+
+		/**
+		 * Completes the associated futures with the given exception instead of a value.
+		 */
+		void setException(std::exception_ptr error) {
+			link->setError(error);
+		}
+
+		/**
+		 * Completes the associated futures with the outcome of the given future once it
+		 * is ready, without waiting for it. The value is moved, the given future has to
+		 * be the only one obtained from its promise.
+		 */
+		void forward(Future<T>&& future) {
+			FPLink<T>* src = future.link;
+			FPLink<T>* dst = link;
+			assert(src && "Forwarding invalid future!");
+			future.link = nullptr;
+			dst->incRef();
+			src->state.addContinuation(detail::makeContinuation([src,dst]() {
+				if (src->error) {
+					dst->setError(src->error);
+				} else {
+					dst->setValue(std::move(src->value));
+				}
+				src->decRef();
+				dst->decRef();
+			}));
+		}
+
+	};
+
+
+	// - void specialization -
+
+	template<>
+	class FPLink<void> : public Pooled {
+
+		friend class Future<void>;
+
+		friend class Promise<void>;
+
+		std::atomic<int> ref_counter;
+
+		// the exception raised while processing the operation, if any
+		std::exception_ptr error;
+
+		CompletionState state;
+
+	private:
+
+		FPLink(bool done = false) : ref_counter(1), state(done) {}
+
+		void incRef() {
+			// a sole owner can not race with anybody else
+			if (ref_counter.load(std::memory_order_relaxed) == 1) {
+				ref_counter.store(2, std::memory_order_relaxed);
+			} else {
+				ref_counter.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		void decRef() {
+			// a sole owner can not race with anybody else
+			if (ref_counter.load(std::memory_order_acquire) == 1 || ref_counter.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				delete this;
+			}
+		}
+
+		bool isDone() const {
+			return state.isDone();
+		}
+
+		void setDone() {
+			state.setDone();
+		}
+
+		void setError(std::exception_ptr error) {
+			this->error = error;
+			state.setDone();
+		}
+
+		void check() const {
+			if (error) std::rethrow_exception(error);
+		}
+
+	};
+
+	template<>
+	class Future<void> {
+
+		template<typename T>
+		friend class Promise;
+
+		FPLink<void>* link;
+
+		Future(FPLink<void>* link) : link(link) {
+			link->incRef();
+		}
+
+	public:
+
+		Future() : link(nullptr) {}
+
+		Future(const Future&) = delete;
+
+		Future(Future&& other) : link(other.link) {
+			other.link = nullptr;
+		}
+
+		~Future() {
+			if (link) link->decRef();
+		}
+
+		Future& operator=(const Future&) = delete;
+
+		Future& operator=(Future&& other) {
+			if (link == other.link) return *this;
+			if (link) link->decRef();
+			link = other.link;
+			other.link = nullptr;
+			return *this;
+		}
+
+		bool isDone() const {
+			return !link || link->isDone();
+		}
+
+		void wait() const;
+
+		void get() const;
+
+		/**
+		 * Registers an operation to be run once this future is ready (see Future<T>::onReady).
+		 */
+		template<typename Fn>
+		void onReady(Fn&& fn) const {
+			if (isDone()) {
+				fn();
+				return;
+			}
+			link->state.addContinuation(detail::makeContinuation(std::forward<Fn>(fn)));
+		}
+
+		/**
+		 * Schedules the given operation as a new task once this future is ready. The
+		 * result of the operation is provided through the returned future.
+		 */
+		template<typename Fn, typename R = decltype(std::declval<Fn&>()())>
+		Future<R> then(Fn&& fn) const;
+
+	};
+
+
+	template<>
+	class Promise<void> {
+
+		FPLink<void>* link;
+
+	public:
+
+		Promise() : link(new FPLink<void>()) {}
+
+		Promise(const Promise& other) : link(other.link) {
+			link->incRef();
+		}
+
+		Promise(Promise& other) : link(other.link) {
+			other.link = nullptr;
+		}
+
+		Promise(Promise&& other) : link(other.link) {
+			other.link = nullptr;
+		}
+
+		~Promise() {
+			if (link) link->decRef();
+		}
+
+		Promise* operator()(const Promise& other) = delete;
+		Promise* operator()(Promise&& other) = delete;
+
+		Future<void> getFuture() {
+			return Future<void>(link);
+		}
+
+		void set() {
+			link->setDone();
+		}
+
+		void setException(std::exception_ptr error) {
+			link->setError(error);
+		}
+
+		void forward(Future<void>&& future) {
+			FPLink<void>* src = future.link;
+			if (!src) {
+				set();
+				return;
+			}
+			FPLink<void>* dst = link;
+			future.link = nullptr;
+			dst->incRef();
+			src->state.addContinuation(detail::makeContinuation([src,dst]() {
+				if (src->error) {
+					dst->setError(src->error);
+				} else {
+					dst->setDone();
+				}
+				src->decRef();
+				dst->decRef();
+			}));
+		}
+
+	};
+
+
+#endif
+
+	namespace detail {
+
+		/**
+		 * Completes the given promise with the given value or, if the value is a future,
+		 * with its outcome once it is ready.
+		 */
+		template<typename R>
+		void complete(Promise<R>& promise, const R& value) {
+			promise.set(value);
+		}
+
+		template<typename R>
+		void complete(Promise<R>& promise, R&& value) {
+			promise.set(std::move(value));
+		}
+
+		template<typename R>
+		void complete(Promise<R>& promise, Future<R>&& future) {
+			promise.forward(std::move(future));
+		}
+
+		template<typename Fn, typename ... Args>
+		typename std::enable_if<std::is_void<decltype(std::declval<Fn&>()(std::declval<const Args&>()...))>::value>::type
+		complete(Promise<void>& promise, Fn& fn, const Args& ... args) {
+			fn(args...);
+			promise.set();
+		}
+
+		template<typename Fn, typename ... Args>
+		typename std::enable_if<!std::is_void<decltype(std::declval<Fn&>()(std::declval<const Args&>()...))>::value>::type
+		complete(Promise<void>& promise, Fn& fn, const Args& ... args) {
+			promise.forward(fn(args...));
+		}
+
+		/**
+		 * Completes the given promise with the result of the given operation, or with the
+		 * exception raised by it, which cancels the given token (see CancellationToken::fail).
+		 * Operations may return a future instead of a value, which is forwarded to the promise.
+		 */
+		template<typename R>
+		struct fulfil {
+			template<typename Fn, typename ... Args>
+			static void apply(CancellationToken& token, Promise<R>& promise, Fn& fn, const Args& ... args) {
+				try {
+					complete(promise, fn(args...));
+				} catch (...) {
+					promise.setException(token.fail(std::current_exception()));
+				}
+			}
+		};
+
+		template<>
+		struct fulfil<void> {
+			template<typename Fn, typename ... Args>
+			static void apply(CancellationToken& token, Promise<void>& promise, Fn& fn, const Args& ... args) {
+				try {
+					complete(promise, fn, args...);
+				} catch (...) {
+					promise.setException(token.fail(std::current_exception()));
+				}
+			}
+		};
+
+		/**
+		 * Determines whether the parallel version of an operation yields the same type of
+		 * result as its sequential version, either directly or through a future.
+		 */
+		template<typename Par, typename Seq>
+		struct is_compatible_result : public std::integral_constant<bool,
+				std::is_same<Par,Seq>::value || std::is_same<Par,Future<Seq>>::value> {};
+
+		/**
+		 * The shared state of a batch of sibling tasks spawned by spawn_n. The body is
+		 * stored once for all tasks; the last finishing task completes the join handle
+		 * and releases the batch.
+		 */
+		template<typename Body>
+		class batch : public Pooled {
+
+			Body body;
+
+			CancellationToken token;
+
+			std::atomic<std::size_t> pending;
+
+			std::atomic<bool> failed;
+
+			// set if some task has been abandoned due to a cancellation
+			std::atomic<bool> skipped;
+
+			// the first failure, published to the last task by the pending counter
+			std::exception_ptr error;
+
+			Promise<void> promise;
+
+		public:
+
+			batch(const Body& body, std::size_t n, const CancellationToken& token)
+				: body(body), token(token), pending(n), failed(false), skipped(false) {}
+
+			Future<void> getFuture() {
+				return promise.getFuture();
+			}
+
+			void run(std::size_t i) {
+				if (!token.isCancelled()) {
+					// a failure abandons the sibling operations
+					CancellationScope scope(token);
+					try {
+						body(i);
+					} catch (...) {
+						auto e = token.fail(std::current_exception());
+						if (!failed.exchange(true)) error = e;
+					}
+				} else {
+					skipped.store(true, std::memory_order_relaxed);
+				}
+				done();
+			}
+
+		private:
+
+			void done() {
+				if (pending.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+				if (error) {
+					promise.setException(error);
+				} else if (skipped.load(std::memory_order_relaxed)) {
+					promise.setException(std::make_exception_ptr(operation_cancelled()));
+				} else {
+					promise.set();
+				}
+				delete this;
+			}
+
+		};
+
+	}
+
+
+	// -----------------------------------------------------------------
+	//						       Tasks
+	// -----------------------------------------------------------------
+
+	/**
+	 * A fixed-size frame for a schedulable task. Closures fitting into the frame's
+	 * storage are placed inline, bigger ones are moved to the heap. Frames are
+	 * recycled through the free lists of the workers processing them, such that
+	 * spawning a task does in general not involve the global allocator.
+	 */
+	class Task {
+
+	public:
+
+		// the total size of a task frame
+		static const std::size_t frame_size = 128;
+
+	private:
+
+		friend class TaskFramePool;
+
+		using handler_type = void(*)(Task&, bool run);
+
+		// the handler running and/or destroying the stored closure
+		handler_type handler;
+
+		// the link to the next frame in a free list
+		Task* next;
+
+		// the storage for the closure
+		using storage_type = typename std::aligned_storage<frame_size - sizeof(handler_type) - sizeof(Task*)>::type;
+		storage_type storage;
+
+		template<typename Lambda>
+		struct inline_handler {
+			static void apply(Task& task, bool run) {
+				auto& lambda = reinterpret_cast<Lambda&>(task.storage);
+				if (run) lambda();
+				lambda.~Lambda();
+			}
+		};
+
+		template<typename Lambda>
+		struct boxed_handler {
+			static void apply(Task& task, bool run) {
+				auto lambda = reinterpret_cast<Lambda*&>(task.storage);
+				if (run) (*lambda)();
+				delete lambda;
+			}
+		};
+
+		template<typename Closure, bool fits>
+		struct placer {
+			template<typename Lambda>
+			static handler_type place(storage_type& storage, Lambda&& lambda) {
+				new (&storage) Closure(std::forward<Lambda>(lambda));
+				return &inline_handler<Closure>::apply;
+			}
+		};
+
+		template<typename Closure>
+		struct placer<Closure,false> {
+			template<typename Lambda>
+			static handler_type place(storage_type& storage, Lambda&& lambda) {
+				reinterpret_cast<Closure*&>(storage) = new Closure(std::forward<Lambda>(lambda));
+				return &boxed_handler<Closure>::apply;
+			}
+		};
+
+	public:
+
+		Task() : handler(nullptr), next(nullptr) {}
+
+		template<typename Lambda>
+		explicit Task(Lambda&& lambda) : Task() {
+			init(std::forward<Lambda>(lambda));
+		}
+
+		Task(const Task&) = delete;
+		Task(Task&&) = delete;
+
+		Task& operator=(const Task&) = delete;
+		Task& operator=(Task&&) = delete;
+
+		~Task() {
+			discard();
+		}
+
+		/**
+		 * Determines whether closures of the given type are stored inline.
+		 */
+		template<typename Lambda>
+		static constexpr bool isInline() {
+			return sizeof(Lambda) <= sizeof(storage_type) && alignof(Lambda) <= alignof(storage_type);
+		}
+
+		/**
+		 * Places the given closure in this frame, which has to be empty.
+		 */
+		template<typename Lambda>
+		void init(Lambda&& lambda) {
+			using closure_type = typename std::decay<Lambda>::type;
+			assert(!handler && "Task frame is already occupied!");
+			handler = placer<closure_type,isInline<closure_type>()>::place(storage, std::forward<Lambda>(lambda));
+		}
+
+		/**
+		 * Determines whether this frame holds a closure.
+		 */
+		bool empty() const {
+			return !handler;
+		}
+
+		/**
+		 * Runs the stored closure and clears this frame.
+		 */
+		void operator()() {
+			auto h = handler;
+			handler = nullptr;
+			h(*this, true);
+		}
+
+		/**
+		 * Destroys the stored closure, if any, without running it.
+		 */
+		void discard() {
+			if (!handler) return;
+			auto h = handler;
+			handler = nullptr;
+			h(*this, false);
+		}
+
+	};
+
+	static_assert(sizeof(Task) == Task::frame_size, "Unexpected task frame size!");
+
+
+	/**
+	 * A free list of task frames. Each worker maintains its own list, which must
+	 * only be accessed by the worker itself.
+	 */
+	class TaskFramePool {
+
+		// the maximum number of retained frames
+		static const std::size_t capacity = 1024;
+
+		Task* head;
+
+		std::size_t size;
+
+	public:
+
+		TaskFramePool() : head(nullptr), size(0) {}
+
+		TaskFramePool(const TaskFramePool&) = delete;
+		TaskFramePool(TaskFramePool&&) = delete;
+
+		TaskFramePool& operator=(const TaskFramePool&) = delete;
+		TaskFramePool& operator=(TaskFramePool&&) = delete;
+
+		~TaskFramePool() {
+			while(head) {
+				Task* cur = head;
+				head = head->next;
+				delete cur;
+			}
+		}
+
+		std::size_t getSize() const {
+			return size;
+		}
+
+		/**
+		 * Obtains an empty task frame, recycling a released one if possible.
+		 */
+		Task* acquire() {
+			if (!head) return new Task();
+			Task* res = head;
+			head = res->next;
+			res->next = nullptr;
+			--size;
+			return res;
+		}
+
+		/**
+		 * Creates a task frame holding the given closure.
+		 */
+		template<typename Lambda>
+		Task* create(Lambda&& lambda) {
+			Task* res = acquire();
+			res->init(std::forward<Lambda>(lambda));
+			return res;
+		}
+
+		/**
+		 * Returns a task frame to this pool.
+		 */
+		void release(Task* task) {
+			task->discard();
+			if (size >= capacity) {
+				delete task;
+				return;
+			}
+			task->next = head;
+			head = task;
+			++size;
+		}
+
+	};
+
+
+	// -----------------------------------------------------------------
+	//						    Worker Pool
+	// -----------------------------------------------------------------
+
+
+	/**
+	 * The policy deciding whether a spawned operation becomes a task or is processed
+	 * immediately by the spawning worker.
+	 */
+	enum class SpawnPolicy {
+
+		/**
+		 * Creates tasks until the local queue of the spawning worker is saturated.
+		 */
+		Eager,
+
+		/**
+		 * Processes operations sequentially unless the local queue of the spawning worker
+		 * ran dry or idle workers are searching for work. This avoids most of the task
+		 * creation overhead if there is nobody to steal the created tasks.
+		 */
+		Lazy
+
+	};
+
+	/**
+	 * The configuration of a worker pool.
+	 */
+	struct PoolConfig {
+
+		// the number of worker threads; the threads submitting tasks are not included
+		int num_workers = 0;
+
+		// the placement policy of the threads of the pool
+		AffinityPolicy affinity = AffinityPolicy::Topology;
+
+		// the CPUs threads may be placed on, all CPUs available to the process if empty
+		std::vector<int> cpus;
+
+		// whether the thread creating the pool should be pinned like a worker
+		bool pin_creator = false;
+
+		// the behaviour of workers running out of work
+		IdlePolicy idle;
+
+		// the number of tasks a worker may nest on its stack; beyond, waiting workers only
+		// help with the subtree of their current task, and spawned operations are
+		// processed directly
+		int max_nesting = 256;
+
+		/**
+		 * Obtains the configuration of the default pool, which may be customized through
+		 * the environment variables NUM_WORKERS (the number of threads including the main
+		 * thread), AFFINITY_POLICY (none, linear or topology) and IDLE_POLICY (latency,
+		 * balanced or batch).
+		 */
+		static PoolConfig fromEnvironment() {
+			PoolConfig res;
+
+			int numThreads = std::thread::hardware_concurrency();
+
+			// parse environment variable
+			if (char* val = std::getenv("NUM_WORKERS")) {
+				auto userDef = std::atoi(val);
+				if (userDef != 0) numThreads = userDef;
+			}
+
+			// must be at least one, the main thread
+			if (numThreads < 1) numThreads = 1;
+			res.num_workers = numThreads - 1;
+
+			// parse the placement policy
+			if (char* val = std::getenv("AFFINITY_POLICY")) {
+				std::string policy = val;
+				if (policy == "none") res.affinity = AffinityPolicy::None;
+				if (policy == "linear") res.affinity = AffinityPolicy::Linear;
+				if (policy == "topology") res.affinity = AffinityPolicy::Topology;
+			}
+
+			// parse the idle policy
+			if (char* val = std::getenv("IDLE_POLICY")) {
+				res.idle = IdlePolicy::fromName(val);
+			}
+
+			// the main thread is pinned like a worker
+			res.pin_creator = true;
+			return res;
+		}
+
+	};
+
+	class WorkerPool;
+
+	/**
+	 * The state of a worker thread. The state is grouped by its users, each group starting
+	 * on its own cache line: the data private to the owner, the task queue shared with
+	 * thieves (which separates its own indices), and data rarely accessed at all. Workers
+	 * are allocated aligned to cache lines, thus neighbouring workers share no lines either.
+	 */
+	struct alignas(cache_line_size) Worker {
+
+		// -- data used by the owning thread only --
+
+		WorkerPool& pool;
+
+		volatile bool alive;
+
+		unsigned random_seed;
+
+		// the index of the worker tasks have been stolen from most recently, -1 if none
+		int last_victim;
+
+		TaskFramePool frames;
+
+		ObjectPool objects;
+
+		// the statistics of this worker
+		WorkerCounters stats;
+
+		// the timeline of this worker
+		TraceBuffer trace;
+
+		// the number of tasks nested on the stack of this worker
+		int depth;
+
+		// the local queue position of the first task spawned by the innermost task
+		std::int64_t base;
+
+		// -- data shared with thieves --
+
+		alignas(cache_line_size) WorkStealingDeque<Task*> queue;
+
+		// -- rarely accessed data --
+
+		alignas(cache_line_size) std::thread thread;
+
+		unsigned id;
+
+		// the indices of potential victims, grouped by their distance, closest first
+		std::vector<std::vector<int>> victims;
+
+	public:
+
+		Worker(WorkerPool& pool, unsigned id)
+			: pool(pool), alive(true), random_seed(id), last_victim(-1), depth(0), base(0), id(id) { }
+
+		Worker(const Worker&) = delete;
+		Worker(Worker&&) = delete;
+
+		Worker& operator=(const Worker&) = delete;
+		Worker& operator=(Worker&&) = delete;
+
+		// workers are over-aligned, which is not supported by operator new before C++17
+		static void* operator new(std::size_t size) {
+			void* res = nullptr;
+			if (posix_memalign(&res, alignof(Worker), size) != 0) throw std::bad_alloc();
+			return res;
+		}
+
+		static void operator delete(void* ptr) {
+			std::free(ptr);
+		}
+
+		void start() {
+			thread = std::thread([&](){ run(); });
+		}
+
+		void poison() {
+			alive = false;
+		}
+
+		bool isAlive() const {
+			return alive;
+		}
+
+		void join() {
+			thread.join();
+		}
+
+	private:
+
+		void run();
+
+		Task* findTask();
+
+		void process(Task* task) {
+			stats.tasks_executed.add();
+
+			// tasks queued from now on are descendants of this task
+			auto outer = base;
+			base = queue.position();
+			++depth;
+			task->operator()();
+			--depth;
+			base = outer;
+
+			frames.release(task);
+		}
+
+	public:
+
+		bool schedule_step();
+
+		/**
+		 * Tests whether this worker reached the nesting limit of its pool.
+		 */
+		bool isNestedDeeply() const;
+
+		/**
+		 * Processes some task while the current task is waiting. Beyond the nesting limit,
+		 * only descendants of the current task are processed, which are bounded by the
+		 * depth of the computation itself instead of the order of unrelated tasks.
+		 */
+		bool help();
+
+		/**
+		 * Processes the newest task of the local queue if it has been queued at the given
+		 * position or above (see WorkStealingDeque::position). Tasks queued by enclosing
+		 * operations are thus not nested on top of the current stack.
+		 */
+		bool schedule_local(std::int64_t pos) {
+			if (Task* t = queue.pop_back_from(pos)) {
+				process(t);
+				return true;
+			}
+			return false;
+		}
+
+	};
+
+
+
+
+	namespace detail {
+
+	#ifdef PAREC_ENABLE_TRACING
+
+		/**
+		 * A task closure recording its execution in the timeline of the processing worker.
+		 */
+		template<typename Lambda>
+		struct traced_task {
+
+			const char* label;
+
+			Lambda lambda;
+
+			void operator()() {
+				TraceLabel scope(label);
+				Worker* worker = getCurrentWorker();
+				if (worker) worker->trace.record(TraceEventType::TaskBegin, label);
+				lambda();
+				if (worker) worker->trace.record(TraceEventType::TaskEnd, label);
+			}
+
+		};
+
+		template<typename Lambda>
+		traced_task<typename std::decay<Lambda>::type> traced(Lambda&& lambda) {
+			return { TraceLabel::get(), std::forward<Lambda>(lambda) };
+		}
+
+	#else
+
+		template<typename Lambda>
+		Lambda&& traced(Lambda&& lambda) {
+			return std::forward<Lambda>(lambda);
+		}
+
+	#endif
+
+	}
+
+	class WorkerPool {
+
+		/**
+		 * If a worker has this number of tasks in its queue, newly spawned tasks are
+		 * processed immediately to limit the task creation overhead. The queue itself is
+		 * not bounded. Since owners process their newest tasks first while thieves take
+		 * the oldest, the queued tasks are the biggest pending sub-trees -- a few of them
+		 * suffice to keep thieves busy.
+		 */
+		static const std::size_t max_queued_tasks = 4;
+
+		/**
+		 * The maximum number of tasks a thief obtains from a victim in a single round.
+		 * Thieves take half of the tasks of their victim up to this limit, the surplus is
+		 * added to their own queue.
+		 */
+		static const std::size_t max_stolen_tasks = max_queued_tasks;
+
+		std::vector<Worker*> workers;
+
+		/**
+		 * The number of tasks submitted by threads not being workers of this pool that
+		 * may be queued without locking. Surplus tasks are kept in an overflow list.
+		 */
+		static const std::size_t max_injected_tasks = 1024;
+
+		// tasks submitted by threads not being workers of this pool
+		MPMCQueue<Task*,max_injected_tasks> injected;
+
+		// injected tasks not fitting into the queue above
+		SpinLock overflow_lock;
+		std::deque<Task*> overflow;
+		std::atomic<std::size_t> overflow_size;
+
+		// the number of idle workers actively searching for work
+		std::atomic<int> searching;
+
+		// the event count idle workers are sleeping on
+		EventCount sleepers;
+
+		// the configuration of this pool
+		PoolConfig config;
+
+		// the CPU of each thread of this pool, indexed by the thread id (0 = creator)
+		std::vector<int> cpus;
+
+		// the statistics of threads not being workers of this pool
+		WorkerCounters external;
+
+		// the statistics at the time of the last reset
+		SpinLock stats_lock;
+		PoolStatistics stats_base;
+
+	public:
+
+		/**
+		 * Creates a pool of workers according to the given configuration. Pools are
+		 * isolated from each other: tasks spawned by the workers of a pool are only
+		 * processed by workers of the same pool.
+		 */
+		explicit WorkerPool(const PoolConfig& config = PoolConfig()) : overflow_size(0), searching(0), config(config) {
+
+			// start workers
+			startWorkers(std::max(0, config.num_workers));
+
+			// fix affinity of the creating thread
+			if (config.pin_creator) pinThread(0);
+		}
+
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool(WorkerPool&&) = delete;
+
+		WorkerPool& operator=(const WorkerPool&) = delete;
+		WorkerPool& operator=(WorkerPool&&) = delete;
+
+		~WorkerPool() {
+			stopWorkers();
+
+			// drop the tasks never processed
+			while(Task* task = takeInjected()) delete task;
+		}
+
+		/**
+		 * Obtains the default pool, which is created on first use based on the default
+		 * configuration.
+		 */
+		static WorkerPool& getInstance() {
+			static WorkerPool pool(getDefaultConfig());
+			return pool;
+		}
+
+		/**
+		 * Sets the configuration of the default pool. This has to be done before the
+		 * default pool is used for the first time, otherwise it has no effect.
+		 */
+		static void setDefaultConfig(const PoolConfig& config) {
+			getDefaultConfig() = config;
+		}
+
+		/**
+		 * Obtains the pool tasks spawned by the current thread are submitted to: the pool
+		 * of the current worker, the pool bound to the current thread by a Scope, or the
+		 * default pool.
+		 */
+		static WorkerPool& getCurrent();
+
+		/**
+		 * Binds the pool tasks are submitted to by the current thread for the life time
+		 * of the scope. Has no effect on workers, which always submit to their own pool.
+		 */
+		class Scope {
+
+			WorkerPool* previous;
+
+		public:
+
+			explicit Scope(WorkerPool& pool) : previous(getBoundPool()) {
+				getBoundPool() = &pool;
+			}
+
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+
+			~Scope() {
+				getBoundPool() = previous;
+			}
+
+		};
+
+		const PoolConfig& getConfig() const {
+			return config;
+		}
+
+		int getNumWorkers() const {
+			return workers.size();
+		}
+
+		Worker& getWorker(int i) {
+			return *workers[i];
+		}
+
+		/**
+		 * Obtains the statistics of this pool since the last reset. Statistics are only
+		 * collected if PAREC_ENABLE_STATISTICS is defined, all values are zero otherwise.
+		 */
+		PoolStatistics getStatistics() {
+			std::lock_guard<SpinLock> g(stats_lock);
+			PoolStatistics res;
+			for(std::size_t i=0; i<workers.size(); ++i) {
+				res.workers.push_back(workers[i]->stats.get());
+				if (i < stats_base.workers.size()) res.workers[i] -= stats_base.workers[i];
+			}
+			res.external = external.get();
+			res.external -= stats_base.external;
+			res.idle = config.idle;
+			return res;
+		}
+
+		/**
+		 * Resets the statistics of this pool. Counters are not modified, thus this is
+		 * safe while workers are active.
+		 */
+		void resetStatistics() {
+			std::lock_guard<SpinLock> g(stats_lock);
+			stats_base.workers.clear();
+			for(const auto& cur : workers) {
+				stats_base.workers.push_back(cur->stats.get());
+			}
+			stats_base.external = external.get();
+		}
+
+		/**
+		 * Writes the timelines of all workers of this pool in the Chrome trace format,
+		 * to be viewed in chrome://tracing or Perfetto. Timelines are only recorded if
+		 * PAREC_ENABLE_TRACING is defined, otherwise the trace is empty. Should be called
+		 * while the pool is idle, since events recorded concurrently may be corrupted.
+		 */
+		void writeTrace(std::ostream& out) const {
+			bool first = true;
+			out << "{\"traceEvents\":[\n";
+			for(const auto& cur : workers) {
+				writeTraceEvents(out, cur->id, cur->trace, first);
+			}
+			out << "\n]}\n";
+		}
+
+		/**
+		 * Clears the timelines of all workers. Should be called while the pool is idle.
+		 */
+		void clearTrace() {
+			for(auto& cur : workers) cur->trace.clear();
+		}
+
+		/**
+		 * Changes the number of workers of this pool. The statistics of the workers are
+		 * reset, pending tasks are preserved. Must not be called by a worker of this pool
+		 * nor concurrently to other threads submitting tasks to this pool -- it is intended
+		 * for switching between phases of an application.
+		 */
+		void resize(int numWorkers) {
+			stopWorkers();
+			config.num_workers = std::max(0, numWorkers);
+			startWorkers(config.num_workers);
+
+			// without workers, left-over tasks are processed by the calling thread
+			if (workers.empty()) {
+				while(Task* task = takeInjected()) {
+					(*task)();
+					delete task;
+				}
+			}
+		}
+
+	private:
+
+		static PoolConfig& getDefaultConfig() {
+			static PoolConfig config = PoolConfig::fromEnvironment();
+			return config;
+		}
+
+		static WorkerPool*& getBoundPool() {
+			thread_local static WorkerPool* pool = nullptr;
+			return pool;
+		}
+
+		void startWorkers(int numWorkers) {
+
+			// create workers
+			for(int i=0; i<numWorkers; ++i) {
+				workers.push_back(new Worker(*this, i+1));
+			}
+
+			// place threads and group victims
+			placeWorkers();
+
+			// start workers
+			for(auto& cur : workers) cur->start();
+		}
+
+		void stopWorkers() {
+
+			// poison all workers
+			for(auto& cur : workers) {
+				cur->poison();
+			}
+
+			// wake up all sleeping workers
+			sleepers.notifyAll();
+
+			// wait for their death
+			for(auto& cur : workers) {
+				cur->join();
+			}
+
+			// preserve tasks left in the queues of the workers
+			for(auto& cur : workers) {
+				while(Task* task = cur->queue.steal()) inject(task);
+			}
+
+			// free resources
+			for(auto& cur : workers) {
+				delete cur;
+			}
+			workers.clear();
+
+			// the statistics of the deleted workers are gone
+			std::lock_guard<SpinLock> g(stats_lock);
+			stats_base.workers.clear();
+		}
+
+		/**
+		 * Assigns CPUs to all threads of this pool according to the affinity policy and
+		 * determines the order in which workers pick their victims.
+		 */
+		void placeWorkers() {
+			int numThreads = getNumWorkers() + 1;
+
+			// assign CPUs
+			cpus.clear();
+			std::vector<CpuInfo> location;
+			if (config.affinity == AffinityPolicy::Linear) {
+				int numCores = std::max(1u, std::thread::hardware_concurrency());
+				for(int i=0; i<numThreads; ++i) {
+					cpus.push_back(config.cpus.empty() ? i % numCores : config.cpus[i % config.cpus.size()]);
+				}
+			} else if (config.affinity == AffinityPolicy::Topology) {
+				auto topology = config.cpus.empty() ? Topology::detect() : Topology::read("/sys/devices/system", config.cpus);
+				auto order = topology.getPlacement();
+				for(int i=0; i<numThreads; ++i) {
+					location.push_back(order[i % order.size()]);
+					cpus.push_back(location.back().id);
+				}
+			}
+
+			// group victims by distance, or treat all of them equally without a topology
+			for(auto& cur : workers) {
+				cur->victims.clear();
+				std::vector<std::vector<int>> levels(location.empty() ? 1 : Topology::num_distances);
+				for(int i=0; i<getNumWorkers(); ++i) {
+					if (workers[i] == cur) continue;
+					int level = location.empty() ? 0 : Topology::getDistance(location[cur->id], location[i+1]);
+					levels[level].push_back(i);
+				}
+				for(auto& level : levels) {
+					if (!level.empty()) cur->victims.push_back(level);
+				}
+			}
+		}
+
+		/**
+		 * Pins the thread of the given id to its CPU, if it has been assigned one.
+		 */
+		void pinThread(unsigned id) const {
+			if (id < cpus.size()) detail::pinToCpu(cpus[id]);
+		}
+
+	protected:
+
+		friend Worker;
+
+		/**
+		 * Registers an idle worker searching for work.
+		 */
+		void startSearching() {
+			searching.fetch_add(1, std::memory_order_seq_cst);
+		}
+
+		/**
+		 * Unregisters a searching worker. If the last searcher found some work, another
+		 * sleeping worker is woken up to take over the search.
+		 */
+		void stopSearching(bool found) {
+			auto before = searching.fetch_sub(1, std::memory_order_seq_cst);
+			if (found && before == 1) sleepers.notifyOne();
+		}
+
+		/**
+		 * Blocks the given worker until new work might be available or the park timeout
+		 * of the idle policy expires. Work announced by a strict call to workAvailable
+		 * is never missed.
+		 */
+		void waitForWork(const Worker& worker) {
+			auto key = sleepers.prepareWait();
+			if (!worker.isAlive() || hasWork()) {
+				sleepers.cancelWait();
+				return;
+			}
+			if (config.idle.park_timeout.count() > 0) {
+				sleepers.commitWait(key, config.idle.park_timeout);
+			} else {
+				sleepers.commitWait(key);
+			}
+		}
+
+		/**
+		 * Wakes up a sleeping worker if there is no worker searching for work. No
+		 * kernel call is conducted unless some worker is actually waiting.
+		 *
+		 * Tasks queued by workers will eventually be processed by their owners, thus
+		 * a missed wakeup only delays the distribution of work until the next spawn.
+		 * For those, the fence required for a strict handshake with workers going to
+		 * sleep is skipped on the spawn path. Injected tasks require a strict check.
+		 */
+		void workAvailable(bool strict) {
+			if (strict) std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (searching.load(std::memory_order_relaxed) > 0) return;
+			if (sleepers.getNumWaiters() == 0) return;
+			sleepers.notifyOne();
+		}
+
+		/**
+		 * Tests whether there is any task in the queues of this pool.
+		 */
+		bool hasWork() {
+			if (!injected.empty() || overflow_size.load(std::memory_order_acquire) > 0) return true;
+			for(const auto& cur : workers) {
+				if (!cur->queue.empty()) return true;
+			}
+			return false;
+		}
+
+		/**
+		 * Enqueues a task submitted by a thread that is not a worker of this pool. Any
+		 * number of threads may submit tasks concurrently.
+		 */
+		void inject(Task* task) {
+			if (injected.push_back(task)) return;
+			std::lock_guard<SpinLock> g(overflow_lock);
+			overflow.push_back(task);
+			overflow_size.fetch_add(1, std::memory_order_release);
+		}
+
+		/**
+		 * Obtains one of the oldest tasks submitted by threads not being workers of this pool.
+		 */
+		Task* takeInjected() {
+			if (Task* res = injected.pop_front()) return res;
+			if (overflow_size.load(std::memory_order_acquire) == 0) return nullptr;
+			std::lock_guard<SpinLock> g(overflow_lock);
+			if (overflow.empty()) return nullptr;
+			Task* res = overflow.front();
+			overflow.pop_front();
+			overflow_size.fetch_sub(1, std::memory_order_relaxed);
+			return res;
+		}
+
+		/**
+		 * Obtains a task from some other worker or the injected tasks.
+		 */
+		Task* steal(Worker& thief) {
+
+			// externally submitted tasks take priority
+			if (Task* t = takeInjected()) return t;
+
+			// try the most recent victim first, since it is likely to have more work
+			int last = thief.last_victim;
+			if (last >= 0) {
+				thief.stats.steal_attempts.add();
+				if (Task* t = workers[last]->queue.steal_half(thief.queue, max_stolen_tasks)) {
+					thief.stats.steal_successes.add();
+					thief.trace.record(TraceEventType::Steal, nullptr);
+					return t;
+				}
+				thief.last_victim = -1;
+			}
+
+			// probe a random victim of each distance, starting with the closest
+			for(const auto& level : thief.victims) {
+				int i = level[rand_r(&thief.random_seed) % level.size()];
+				if (i == last) continue;
+				thief.stats.steal_attempts.add();
+				if (Task* t = workers[i]->queue.steal_half(thief.queue, max_stolen_tasks)) {
+					thief.stats.steal_successes.add();
+					thief.trace.record(TraceEventType::Steal, nullptr);
+					thief.last_victim = i;
+					return t;
+				}
+			}
+
+			// no work found
+			return nullptr;
+		}
+
+	public:
+
+		/**
+		 * Waits on behalf of a thread that is not a worker of this pool. External threads
+		 * do not process tasks, since nesting arbitrary tasks on their stacks while
+		 * waiting would not be bounded by the local task order.
+		 */
+		static bool schedule_step_external() {
+			std::this_thread::yield();
+			return false;
+		}
+
+	private:
+
+		bool isSaturated(SpawnPolicy policy) const;
+
+		/**
+		 * Tests whether the current thread is a worker of this pool beyond the nesting limit.
+		 */
+		bool isNestedDeeply() const;
+
+		/**
+		 * Records that the current thread processed a spawned operation immediately.
+		 */
+		void countInlineFallback();
+
+		template<typename Lambda>
+		void schedule(Lambda&& lambda);
+
+		template<typename LambdaPar, typename R>
+		struct runner {
+			Future<R> operator()(WorkerPool& pool, const LambdaPar& par) {
+
+				// create a schedulable task, inheriting the cancellation token of the spawning thread
+				Promise<R> p;
+				auto res = p.getFuture();
+				pool.schedule([p=std::move(p),par,token=CancellationToken::getCurrent()]() mutable {
+					if (token.isCancelled()) {
+						p.setException(std::make_exception_ptr(operation_cancelled()));
+						return;
+					}
+					// a failure abandons the sibling operations
+					CancellationScope scope(token);
+					detail::fulfil<R>::apply(token, p, par);
+				});
+
+				// return future
+				return res;
+			}
+		};
+
+		template<typename LambdaPar>
+		struct runner<LambdaPar,void> {
+			Future<void> operator()(WorkerPool& pool, const LambdaPar& par) {
+
+				// create a schedulable task, inheriting the cancellation token of the spawning thread
+				Promise<void> p;
+				auto res = p.getFuture();
+				pool.schedule([p=std::move(p),par,token=CancellationToken::getCurrent()]() mutable {
+					if (token.isCancelled()) {
+						p.setException(std::make_exception_ptr(operation_cancelled()));
+						return;
+					}
+					// a failure abandons the sibling operations
+					CancellationScope scope(token);
+					detail::fulfil<void>::apply(token, p, par);
+				});
+
+				// return future
+				return res;
+
+			}
+		};
+
+		template<typename LambdaSeq, typename R>
+		struct direct_runner {
+			Future<R> operator()(const LambdaSeq& seq) {
+				try {
+					return seq();
+				} catch (...) {
+					// a failure abandons the sibling operations
+					std::rethrow_exception(CancellationToken::getCurrent().fail(std::current_exception()));
+				}
+			}
+		};
+
+		template<typename LambdaSeq>
+		struct direct_runner<LambdaSeq,void> {
+			Future<void> operator()(const LambdaSeq& seq) {
+				try {
+					seq();
+				} catch (...) {
+					std::rethrow_exception(CancellationToken::getCurrent().fail(std::current_exception()));
+				}
+				return Future<void>();
+			}
+		};
+
+		template<typename R>
+		static Future<R> cancelled() {
+			Promise<R> p;
+			auto res = p.getFuture();
+			p.setException(std::make_exception_ptr(operation_cancelled()));
+			return res;
+		}
+
+	public:
+
+		/**
+		 * Schedules the given operation as a task of this pool without creating a future.
+		 * Without workers, the operation is processed immediately.
+		 */
+		template<typename Lambda>
+		void submit(Lambda&& lambda) {
+			if (getNumWorkers() == 0) {
+				lambda();
+				return;
+			}
+			schedule(std::forward<Lambda>(lambda));
+		}
+
+		/**
+		 * Spawns n sibling tasks, the i-th of which calls body(i), and returns a single
+		 * handle joining all of them. The tasks are enqueued at once and announced by a
+		 * single wakeup; sleeping workers wake up each other while work remains. The
+		 * first failure of the body is reported through the handle and cancels the
+		 * remaining tasks.
+		 */
+		template<typename Body>
+		Future<void> spawn_n(std::size_t n, const Body& body);
+
+		template<typename LambdaSeq, typename LambdaPar, typename R>
+		Future<R> spawn(const LambdaSeq& seq, const LambdaPar& par, SpawnPolicy policy = SpawnPolicy::Eager) {
+
+			// skip operations spawned by cancelled ones
+			if (isCancelled()) return cancelled<R>();
+
+			// check whether there are any workers, whether there is enough local work or
+			// whether the stack is deep already
+			if (getNumWorkers() == 0 || isSaturated(policy) || isNestedDeeply()) {
+				// process directly
+				countInlineFallback();
+				return direct_runner<LambdaSeq,R>()(seq);
+			}
+
+			// run task
+			return runner<LambdaPar,R>()(*this, par);
+		}
+
+	};
+
+	/**
+	 * Processes some other task on the current thread while waiting for a result.
+	 */
+	inline bool schedule_step() {
+		if (Worker* worker = getCurrentWorker()) return worker->schedule_step();
+		return WorkerPool::schedule_step_external();
+	}
+
+	namespace detail {
+
+		/**
+		 * Processes some other task on the current thread while waiting for a result. Unlike
+		 * schedule_step, workers respect the nesting limit of their pool (see Worker::help).
+		 */
+		inline bool help() {
+			if (Worker* worker = getCurrentWorker()) return worker->help();
+			return WorkerPool::schedule_step_external();
+		}
+
+		// the number of polling rounds of threads not being workers before blocking on a future
+		static const int external_spin_cycles = 100;
+
+		/**
+		 * Obtains the parker of the current thread. It is shared with the continuations
+		 * waking up the thread, which may run after the thread is gone.
+		 */
+		inline const std::shared_ptr<Parker>& getParker() {
+			thread_local static std::shared_ptr<Parker> parker = std::make_shared<Parker>();
+			return parker;
+		}
+
+		/**
+		 * Waits for the given future to become ready. Workers process other tasks in the
+		 * meanwhile. Other threads spin for a moment and then sleep until the future is
+		 * completed, without taking part in the processing of tasks.
+		 */
+		template<typename Handle>
+		void waitFor(const Handle& handle) {
+			if (handle.isDone()) return;
+
+			// workers keep processing tasks
+			if (Worker* worker = getCurrentWorker()) {
+				while (!handle.isDone()) worker->help();
+				return;
+			}
+
+			// other threads poll for a while ...
+			for(int i=0; i<external_spin_cycles; ++i) {
+				cpu_relax();
+				if (handle.isDone()) return;
+			}
+
+			// ... and then sleep until woken up by the completing thread
+			const auto& p = getParker();
+			handle.onReady([p]() { p->unpark(); });
+			while (!handle.isDone()) p->park();
+		}
+
+	}
+
+	template<typename T>
+	void Future<T>::wait() const {
+		detail::waitFor(*this);
+	}
+
+#ifdef PAREC_INLINE_FUTURES
+
+	template<typename T>
+	const T& Future<T>::get() const {
+		wait();
+		if (this->res.error) std::rethrow_exception(this->res.error);
+		return this->res.value;
+	}
+
+	template<typename T>
+	T&& Future<T>::extract() {
+		get();
+		return std::move(this->res.value);
+	}
+
+	inline void Future<void>::wait() const {
+		detail::waitFor(*this);
+	}
+
+	inline void Future<void>::get() const {
+		wait();
+		if (res.error) std::rethrow_exception(res.error);
+	}
+
+	template<typename T>
+	template<typename Fn, typename R>
+	Future<R> Future<T>::then(Fn&& fn) const {
+		Promise<R> promise;
+		auto res = promise.getFuture();
+
+		// the outcome of this future is copied, since this future may be gone meanwhile
+		this->onCompletion([p=std::move(promise),f=std::forward<Fn>(fn)](const detail::result<T>& r) mutable {
+			WorkerPool::getCurrent().submit([p=std::move(p),f=std::move(f),r]() mutable {
+				// failures of this future are forwarded to the continuation's result
+				if (r.error) {
+					p.setException(r.error);
+				} else {
+					CancellationToken none;
+					detail::fulfil<R>::apply(none, p, f, r.value);
+				}
+			});
+		});
+		return res;
+	}
+
+	template<typename Fn, typename R>
+	Future<R> Future<void>::then(Fn&& fn) const {
+		Promise<R> promise;
+		auto res = promise.getFuture();
+		onCompletion([p=std::move(promise),f=std::forward<Fn>(fn)](const detail::result<void>& r) mutable {
+			WorkerPool::getCurrent().submit([p=std::move(p),f=std::move(f),error=r.error]() mutable {
+				// failures of this future are forwarded to the continuation's result
+				if (error) {
+					p.setException(error);
+				} else {
+					CancellationToken none;
+					detail::fulfil<R>::apply(none, p, f);
+				}
+			});
+		});
+		return res;
+	}
+
+#else
+
+	template<typename T>
+	const T& Future<T>::get() const {
+		wait();
+		return link->getValue();
+	}
+
+	template<typename T>
+	T&& Future<T>::extract() {
+		wait();
+		return std::move(const_cast<T&>(link->getValue()));
+	}
+
+	inline void Future<void>::wait() const {
+		detail::waitFor(*this);
+	}
+
+	inline void Future<void>::get() const {
+		wait();
+		if (link) link->check();
+	}
+
+	template<typename T>
+	template<typename Fn, typename R>
+	Future<R> Future<T>::then(Fn&& fn) const {
+		assert(link && "Continuation on invalid future!");
+		Promise<R> promise;
+		auto res = promise.getFuture();
+
+		// keep the shared state alive until the continuation has been processed
+		FPLink<T>* l = link;
+		l->incRef();
+		onReady([l,p=std::move(promise),f=std::forward<Fn>(fn)]() mutable {
+			WorkerPool::getCurrent().submit([l,p=std::move(p),f=std::move(f)]() mutable {
+				// failures of this future are forwarded to the continuation's result
+				if (l->error) {
+					p.setException(l->error);
+				} else {
+					CancellationToken none;
+					detail::fulfil<R>::apply(none, p, f, l->value);
+				}
+				l->decRef();
+			});
+		});
+		return res;
+	}
+
+	template<typename Fn, typename R>
+	Future<R> Future<void>::then(Fn&& fn) const {
+		Promise<R> promise;
+		auto res = promise.getFuture();
+
+		// keep the shared state alive until the continuation has been processed
+		FPLink<void>* l = link;
+		if (l) l->incRef();
+		onReady([l,p=std::move(promise),f=std::forward<Fn>(fn)]() mutable {
+			WorkerPool::getCurrent().submit([l,p=std::move(p),f=std::move(f)]() mutable {
+				// failures of this future are forwarded to the continuation's result
+				if (l && l->error) {
+					p.setException(l->error);
+				} else {
+					CancellationToken none;
+					detail::fulfil<R>::apply(none, p, f);
+				}
+				if (l) l->decRef();
+			});
+		});
+		return res;
+	}
+
+#endif
+
+	inline bool WorkerPool::isSaturated(SpawnPolicy policy) const {
+		Worker* worker = getCurrentWorker();
+		if (!worker || &worker->pool != this) return false;
+
+		// the soft limit applies to all policies
+		auto size = worker->queue.size();
+		if (size >= max_queued_tasks) return true;
+		if (policy == SpawnPolicy::Eager) return false;
+
+		// lazy spawning: only split if the local queue ran dry or thieves are waiting
+		return size > 0 && searching.load(std::memory_order_relaxed) == 0;
+	}
+
+	inline bool WorkerPool::isNestedDeeply() const {
+		Worker* worker = getCurrentWorker();
+		return worker && &worker->pool == this && worker->isNestedDeeply();
+	}
+
+	inline void WorkerPool::countInlineFallback() {
+		Worker* worker = getCurrentWorker();
+		if (worker && &worker->pool == this) {
+			worker->stats.inline_fallbacks.add();
+		} else {
+			external.inline_fallbacks.addShared();
+		}
+	}
+
+	template<typename Lambda>
+	void WorkerPool::schedule(Lambda&& lambda) {
+		// tasks spawned by workers go to their own queue using recycled frames, others are injected
+		Worker* worker = getCurrentWorker();
+		if (worker && &worker->pool == this) {
+			worker->queue.push_back(worker->frames.create(detail::traced(std::forward<Lambda>(lambda))));
+			worker->stats.tasks_spawned.add();
+			worker->trace.record(TraceEventType::Spawn, TraceLabel::get());
+			workAvailable(false);
+		} else {
+			inject(new Task(detail::traced(std::forward<Lambda>(lambda))));
+			external.tasks_spawned.addShared();
+			workAvailable(true);
+		}
+	}
+
+	template<typename Body>
+	Future<void> WorkerPool::spawn_n(std::size_t n, const Body& body) {
+
+		// skip operations spawned by cancelled ones
+		if (n == 0) return Future<void>();
+		if (isCancelled()) return cancelled<void>();
+
+		// without workers, the batch is processed directly
+		if (getNumWorkers() == 0) {
+			countInlineFallback();
+			try {
+				for(std::size_t i=0; i<n; ++i) body(i);
+			} catch (...) {
+				std::rethrow_exception(CancellationToken::getCurrent().fail(std::current_exception()));
+			}
+			return Future<void>();
+		}
+
+		// the tasks only refer to the shared state and their index
+		auto state = new detail::batch<Body>(body, n, CancellationToken::getCurrent());
+		auto res = state->getFuture();
+		auto task = [state](std::size_t i) {
+			return detail::traced([state,i]() { state->run(i); });
+		};
+
+		// tasks of workers are published by a single deque operation, others are injected
+		Worker* worker = getCurrentWorker();
+		if (worker && &worker->pool == this) {
+			worker->queue.push_back_n(n, [&](std::size_t i) { return worker->frames.create(task(i)); });
+			worker->stats.tasks_spawned.add(n);
+			for(std::size_t i=0; i<n; ++i) worker->trace.record(TraceEventType::Spawn, TraceLabel::get());
+			workAvailable(false);
+		} else {
+			for(std::size_t i=0; i<n; ++i) inject(new Task(task(i)));
+			external.tasks_spawned.addShared(n);
+			workAvailable(true);
+		}
+		return res;
+	}
+
+	inline void Worker::run() {
+
+		// fix affinity
+		pool.pinThread(id);
+
+		// register worker
+		setCurrentWorker(*this);
+
+		// start processing loop
+		while(alive) {
+
+			// process tasks as long as there are some
+			if (schedule_step()) continue;
+
+			// search for work for a while, as instructed by the idle policy
+			const IdlePolicy& idle = pool.config.idle;
+			pool.startSearching();
+			auto begin = WorkerCounters::now();
+			Task* task = nullptr;
+			int pause = 1;
+			for(int idle_cycles = 0; alive && !task && idle_cycles < idle.spin_cycles; ++idle_cycles) {
+				// wait a moment
+				for(int i=0; i<pause; ++i) cpu_relax();
+				if (idle.backoff && pause < idle.max_backoff) pause *= 2;
+				task = findTask();
+			}
+			for(int idle_cycles = 0; alive && !task && idle_cycles < idle.yield_cycles; ++idle_cycles) {
+				// let other threads work
+				std::this_thread::yield();
+				task = findTask();
+			}
+			pool.stopSearching(task);
+			stats.spin_time.add(WorkerCounters::now() - begin);
+
+			// process the task found
+			if (task) {
+				process(task);
+				continue;
+			}
+
+			// if there was no work for quite some time, sleep until there is new work
+			if (idle.park) {
+				begin = WorkerCounters::now();
+				trace.record(TraceEventType::ParkBegin, nullptr);
+				pool.waitForWork(*this);
+				trace.record(TraceEventType::ParkEnd, nullptr);
+				stats.park_time.add(WorkerCounters::now() - begin);
+			} else {
+				std::this_thread::yield();
+			}
+		}
+
+		// done
+
+	}
+
+	inline Task* Worker::findTask() {
+
+		// take the most recently spawned task from the local queue
+		if (Task* t = queue.pop_back()) return t;
+
+		// otherwise, steal the oldest task of another worker
+		return pool.steal(*this);
+	}
+
+	inline bool Worker::schedule_step() {
+
+		// process a task, if there is any
+		if (Task* t = findTask()) {
+			process(t);
+			return true;
+		}
+
+		// no task found => wait a moment
+		return false;
+	}
+
+	inline bool Worker::isNestedDeeply() const {
+		return depth >= pool.config.max_nesting;
+	}
+
+	inline bool Worker::help() {
+		if (!isNestedDeeply()) return schedule_step();
+
+		// restricted to the subtree of the current task
+		if (schedule_local(base)) return true;
+		cpu_relax();
+		return false;
+	}
+
+
+	static Worker* getCurrentWorker() {
+		return tl_worker;
+	}
+
+	inline WorkerPool& WorkerPool::getCurrent() {
+		if (Worker* worker = getCurrentWorker()) return worker->pool;
+		if (WorkerPool* pool = getBoundPool()) return *pool;
+		return getInstance();
+	}
+
+	inline void* ObjectPool::allocateLocal(std::size_t size) {
+		if (Worker* worker = getCurrentWorker()) return worker->objects.allocate(size);
+		return ::operator new(getBlockSize(size));
+	}
+
+	inline void ObjectPool::deallocateLocal(void* ptr, std::size_t size) {
+		if (Worker* worker = getCurrentWorker()) {
+			worker->objects.deallocate(ptr, size);
+			return;
+		}
+		::operator delete(ptr);
+	}
+
+	template<
+		typename LambdaSeq,
+		typename LambdaPar,
+		typename filter = typename std::enable_if<!std::is_same<LambdaSeq,WorkerPool>::value,int>::type,
+		typename R = typename std::enable_if<
+			detail::is_compatible_result<
+				typename lambda_traits<LambdaPar>::result_type,
+				typename lambda_traits<LambdaSeq>::result_type
+			>::value,
+			typename lambda_traits<LambdaSeq>::result_type
+		>::type
+	>
+	Future<R> spawn(const LambdaSeq& seq, const LambdaPar& par) {
+		return WorkerPool::getCurrent().spawn<LambdaSeq,LambdaPar,R>(seq,par);
+	}
+
+	template<
+		typename LambdaSeq,
+		typename LambdaPar,
+		typename R = typename std::enable_if<
+			detail::is_compatible_result<
+				typename lambda_traits<LambdaPar>::result_type,
+				typename lambda_traits<LambdaSeq>::result_type
+			>::value,
+			typename lambda_traits<LambdaSeq>::result_type
+		>::type
+	>
+	Future<R> spawn(SpawnPolicy policy, const LambdaSeq& seq, const LambdaPar& par) {
+		return WorkerPool::getCurrent().spawn<LambdaSeq,LambdaPar,R>(seq,par,policy);
+	}
+
+	template<
+		typename LambdaSeq,
+		typename LambdaPar,
+		typename R = typename std::enable_if<
+			detail::is_compatible_result<
+				typename lambda_traits<LambdaPar>::result_type,
+				typename lambda_traits<LambdaSeq>::result_type
+			>::value,
+			typename lambda_traits<LambdaSeq>::result_type
+		>::type
+	>
+	Future<R> spawn(WorkerPool& pool, const LambdaSeq& seq, const LambdaPar& par) {
+		return pool.spawn<LambdaSeq,LambdaPar,R>(seq,par);
+	}
+
+	template<
 		typename Lambda,
 		typename R = typename lambda_traits<Lambda>::result_type
 	>
@@ -856,6 +3104,353 @@ namespace runtime {
 		return spawn(lambda,lambda);		// only one version => use it for seq and parallel case
 	}
 
+	template<
+		typename Lambda,
+		typename R = typename lambda_traits<Lambda>::result_type
+	>
+	Future<R> spawn(WorkerPool& pool, const Lambda& lambda) {
+		return spawn(pool,lambda,lambda);
+	}
+
+	/**
+	 * Spawns n sibling tasks calling body(0) ... body(n-1), joined by the returned future.
+	 */
+	template<typename Body>
+	Future<void> spawn_n(std::size_t n, const Body& body) {
+		return WorkerPool::getCurrent().spawn_n(n,body);
+	}
+
+	template<typename Body>
+	Future<void> spawn_n(WorkerPool& pool, std::size_t n, const Body& body) {
+		return pool.spawn_n(n,body);
+	}
+
+
+	// --- task groups ---
+
+	/**
+	 * A fork-join scope for sibling operations. Operations are started by run and joined
+	 * by wait; unlike spawn, they produce no futures, the group only tracks the number of
+	 * pending operations. The first failure of an operation is rethrown by wait and
+	 * abandons the operations spawned within the cancellation scope of the group's creator.
+	 * Operations skipped since the scope got cancelled make wait throw operation_cancelled,
+	 * unless an operation failed.
+	 *
+	 * While waiting, the worker owning the group only processes tasks it queued after the
+	 * group has been started, which are those of the group and their descendants. Thus,
+	 * its stack grows with the depth of the group's subtree only. Operations taken by
+	 * other workers are waited for without processing other work, as instructed by the
+	 * idle policy of the pool. Other workers help processing the tasks of their pool while
+	 * waiting, threads not being workers sleep until woken up by the last operation of
+	 * the group.
+	 */
+	class TaskGroup {
+
+		WorkerPool& pool;
+
+		// the worker owning this group, if created by a worker of the pool
+		Worker* owner;
+
+		// the lowest local queue position of operations run by the owner
+		std::int64_t bottom;
+
+		// the flag marking a sleeping waiter in the pending counter
+		static const std::size_t waiting = std::size_t(1) << (std::numeric_limits<std::size_t>::digits - 1);
+
+		// the value of the pending counter once the last operation woke up the waiter
+		static const std::size_t released = ~std::size_t(0);
+
+		// the number of pending operations, possibly flagged by waiting
+		std::atomic<std::size_t> pending;
+
+		std::atomic<bool> failed;
+
+		// the first failure, published to the waiting thread by the pending counter
+		std::exception_ptr error;
+
+		// whether operations have been skipped due to cancellation
+		std::atomic<bool> skipped;
+
+		CancellationToken token;
+
+		// the parker of the sleeping waiter, published by the waiting flag
+		std::shared_ptr<Parker> parker;
+
+	public:
+
+		TaskGroup() : TaskGroup(WorkerPool::getCurrent()) {}
+
+		explicit TaskGroup(WorkerPool& pool)
+			: pool(pool), owner(nullptr), bottom(std::numeric_limits<std::int64_t>::max()),
+			  pending(0), failed(false), skipped(false), token(CancellationToken::getCurrent()) {
+			Worker* worker = getCurrentWorker();
+			if (worker && &worker->pool == &pool) owner = worker;
+		}
+
+		TaskGroup(const TaskGroup&) = delete;
+		TaskGroup(TaskGroup&&) = delete;
+
+		TaskGroup& operator=(const TaskGroup&) = delete;
+		TaskGroup& operator=(TaskGroup&&) = delete;
+
+		~TaskGroup() {
+			// operations may refer to this group, they have to be completed
+			join();
+		}
+
+		/**
+		 * Starts the given operation as a task of this group.
+		 */
+		template<typename Fn>
+		void run(Fn&& fn) {
+			if (token.isCancelled()) {
+				skipped.store(true, std::memory_order_relaxed);
+				return;
+			}
+			pending.fetch_add(1, std::memory_order_relaxed);
+			if (owner && getCurrentWorker() == owner) {
+				bottom = std::min(bottom, owner->queue.position());
+			}
+			pool.submit([this,fn=std::forward<Fn>(fn)]() mutable {
+				execute(fn);
+				release();
+			});
+		}
+
+		/**
+		 * Processes the given operation as the last one of this group on the current
+		 * thread and waits for all operations of this group.
+		 */
+		template<typename Fn>
+		void runAndWait(Fn&& fn) {
+			execute(fn);
+			wait();
+		}
+
+		/**
+		 * Waits for all operations of this group. If any of them failed, the first
+		 * failure is rethrown; if any of them got skipped due to cancellation,
+		 * operation_cancelled is thrown.
+		 */
+		void wait() {
+			join();
+			bool cancelled = skipped.exchange(false, std::memory_order_relaxed);
+			if (error) {
+				auto res = error;
+				error = nullptr;
+				failed = false;
+				std::rethrow_exception(res);
+			}
+			if (cancelled) throw operation_cancelled();
+		}
+
+	private:
+
+		template<typename Fn>
+		void execute(Fn& fn) {
+			// skip operations abandoned by a failure
+			if (token.isCancelled()) {
+				skipped.store(true, std::memory_order_relaxed);
+				return;
+			}
+			CancellationScope scope(token);
+			try {
+				fn();
+			} catch (...) {
+				auto e = token.fail(std::current_exception());
+				if (!failed.exchange(true)) error = e;
+			}
+		}
+
+		void release() {
+			// this group may be gone once the counter is released, unless a waiter is sleeping
+			if (pending.fetch_sub(1, std::memory_order_acq_rel) != (waiting | 1)) return;
+			auto p = parker;
+			pending.store(released, std::memory_order_release);
+			p->unpark();
+		}
+
+		void join() {
+			if (pending.load(std::memory_order_acquire) == 0) return;
+
+			// the owner processes the tasks of this group's subtree in its queue ...
+			Worker* worker = getCurrentWorker();
+			if (worker && worker == owner) {
+				while (pending.load(std::memory_order_acquire) > 0) {
+					// no more tasks may show up there once it ran dry
+					if (!worker->schedule_local(bottom)) break;
+				}
+				if (pending.load(std::memory_order_acquire) == 0) return;
+
+				// ... and then waits for those taken by other workers like an idle worker
+				const IdlePolicy& idle = pool.getConfig().idle;
+				int pause = 1;
+				for(int i=0; i<idle.spin_cycles; ++i) {
+					for(int j=0; j<pause; ++j) cpu_relax();
+					if (idle.backoff && pause < idle.max_backoff) pause *= 2;
+					if (pending.load(std::memory_order_acquire) == 0) return;
+				}
+				for(int i=0; i<idle.yield_cycles; ++i) {
+					std::this_thread::yield();
+					if (pending.load(std::memory_order_acquire) == 0) return;
+				}
+				if (idle.park) {
+					sleep();
+				} else {
+					while (pending.load(std::memory_order_acquire) > 0) std::this_thread::yield();
+				}
+				return;
+			}
+
+			// other workers keep processing tasks
+			if (worker) {
+				while (pending.load(std::memory_order_acquire) > 0) worker->help();
+				return;
+			}
+
+			// other threads poll for a while and then sleep
+			for(int i=0; i<detail::external_spin_cycles; ++i) {
+				cpu_relax();
+				if (pending.load(std::memory_order_acquire) == 0) return;
+			}
+			sleep();
+		}
+
+		/**
+		 * Sleeps until woken up by the last pending operation.
+		 */
+		void sleep() {
+			parker = detail::getParker();
+			auto cur = pending.load(std::memory_order_relaxed);
+			do {
+				if (cur == 0) {
+					parker.reset();
+					return;
+				}
+			} while (!pending.compare_exchange_weak(cur, cur | waiting, std::memory_order_acq_rel, std::memory_order_acquire));
+			while (pending.load(std::memory_order_acquire) != released) parker->park();
+			pending.store(0, std::memory_order_relaxed);
+			parker.reset();
+		}
+
+	};
+
+
+	// --- combinators ---
+
+	namespace detail {
+
+		/**
+		 * Counts the pending futures of a when_all operation.
+		 */
+		class all_counter : public Pooled {
+
+			std::atomic<std::size_t> pending;
+
+			Promise<void> promise;
+
+		public:
+
+			all_counter(std::size_t pending) : pending(pending) {}
+
+			Future<void> getFuture() {
+				return promise.getFuture();
+			}
+
+			void done() {
+				if (pending.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+				promise.set();
+				delete this;
+			}
+
+		};
+
+		/**
+		 * Selects the first completed future of a when_any operation.
+		 */
+		class any_selector : public Pooled {
+
+			std::atomic<std::size_t> pending;
+
+			std::atomic<bool> selected;
+
+			Promise<std::size_t> promise;
+
+		public:
+
+			any_selector(std::size_t pending) : pending(pending), selected(false) {}
+
+			Future<std::size_t> getFuture() {
+				return promise.getFuture();
+			}
+
+			void done(std::size_t index) {
+				if (!selected.load(std::memory_order_relaxed) && !selected.exchange(true, std::memory_order_relaxed)) {
+					promise.set(index);
+				}
+				if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+			}
+
+		};
+
+	}
+
+	/**
+	 * Obtains a future which is ready once all the given futures are ready.
+	 */
+	template<typename T>
+	Future<void> when_all(const std::vector<Future<T>>& futures) {
+		// the extra count is released once all continuations are registered
+		auto counter = new detail::all_counter(futures.size() + 1);
+		auto res = counter->getFuture();
+		for(const auto& cur : futures) {
+			cur.onReady([counter]() { counter->done(); });
+		}
+		counter->done();
+		return res;
+	}
+
+	/**
+	 * Obtains a future which is ready once all the given futures are ready.
+	 */
+	template<typename ... Ts>
+	Future<void> when_all(const Future<Ts>& ... futures) {
+		auto counter = new detail::all_counter(sizeof...(Ts) + 1);
+		auto res = counter->getFuture();
+		(void)std::initializer_list<int>{ (futures.onReady([counter]() { counter->done(); }), 0)... };
+		counter->done();
+		return res;
+	}
+
+	/**
+	 * Obtains a future providing the index of the first of the given futures being
+	 * ready. If there are no futures, the result is 0.
+	 */
+	template<typename T>
+	Future<std::size_t> when_any(const std::vector<Future<T>>& futures) {
+		if (futures.empty()) return std::size_t(0);
+		auto selector = new detail::any_selector(futures.size());
+		auto res = selector->getFuture();
+		for(std::size_t i=0; i<futures.size(); ++i) {
+			futures[i].onReady([selector,i]() { selector->done(i); });
+		}
+		return res;
+	}
+
+	/**
+	 * Obtains a future providing the index of the first of the given futures being
+	 * ready.
+	 */
+	template<typename ... Ts>
+	Future<std::size_t> when_any(const Future<Ts>& ... futures) {
+		static_assert(sizeof...(Ts) > 0, "At least one future is required!");
+		auto selector = new detail::any_selector(sizeof...(Ts));
+		auto res = selector->getFuture();
+		std::size_t i = 0;
+		(void)std::initializer_list<int>{ (futures.onReady([selector,idx=i++]() { selector->done(idx); }), 0)... };
+		return res;
+	}
+
 } // end namespace runtime
 } // end namespace utils
 } // end namespace parec
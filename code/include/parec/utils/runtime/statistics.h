@@ -0,0 +1,203 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "parec/utils/runtime/idle.h"
+
+/**
+ * The scheduler statistics are only collected if PAREC_ENABLE_STATISTICS is defined
+ * before including the runtime. Otherwise all counters are compiled out and report
+ * zero.
+ */
+
+namespace parec {
+namespace utils {
+namespace runtime {
+
+	/**
+	 * A snapshot of the activities of a worker (or of a group of workers).
+	 */
+	struct WorkerStatistics {
+
+		// the number of tasks processed
+		std::uint64_t tasks_executed = 0;
+
+		// the number of tasks created
+		std::uint64_t tasks_spawned = 0;
+
+		// the number of spawned operations processed immediately instead of creating a task
+		std::uint64_t inline_fallbacks = 0;
+
+		// the number of victims probed for work
+		std::uint64_t steal_attempts = 0;
+
+		// the number of probes obtaining some work
+		std::uint64_t steal_successes = 0;
+
+		// the time spent searching for work, in nanoseconds
+		std::uint64_t spin_time = 0;
+
+		// the time spent sleeping while waiting for work, in nanoseconds
+		std::uint64_t park_time = 0;
+
+		WorkerStatistics& operator+=(const WorkerStatistics& other) {
+			tasks_executed += other.tasks_executed;
+			tasks_spawned += other.tasks_spawned;
+			inline_fallbacks += other.inline_fallbacks;
+			steal_attempts += other.steal_attempts;
+			steal_successes += other.steal_successes;
+			spin_time += other.spin_time;
+			park_time += other.park_time;
+			return *this;
+		}
+
+		WorkerStatistics& operator-=(const WorkerStatistics& other) {
+			tasks_executed -= other.tasks_executed;
+			tasks_spawned -= other.tasks_spawned;
+			inline_fallbacks -= other.inline_fallbacks;
+			steal_attempts -= other.steal_attempts;
+			steal_successes -= other.steal_successes;
+			spin_time -= other.spin_time;
+			park_time -= other.park_time;
+			return *this;
+		}
+
+		friend std::ostream& operator<<(std::ostream& out, const WorkerStatistics& stats) {
+			return out << "executed: " << stats.tasks_executed
+					<< ", spawned: " << stats.tasks_spawned
+					<< ", inlined: " << stats.inline_fallbacks
+					<< ", steals: " << stats.steal_successes << "/" << stats.steal_attempts
+					<< ", spinning: " << stats.spin_time / 1000 << "us"
+					<< ", parked: " << stats.park_time / 1000 << "us";
+		}
+
+	};
+
+	/**
+	 * A snapshot of the activities of all workers of a pool.
+	 */
+	struct PoolStatistics {
+
+		// the statistics of the individual workers
+		std::vector<WorkerStatistics> workers;
+
+		// the operations conducted by threads not being workers of the pool
+		WorkerStatistics external;
+
+		// the idle policy of the workers
+		IdlePolicy idle;
+
+		/**
+		 * Obtains the accumulated statistics of all threads.
+		 */
+		WorkerStatistics getTotal() const {
+			WorkerStatistics res = external;
+			for(const auto& cur : workers) res += cur;
+			return res;
+		}
+
+		friend std::ostream& operator<<(std::ostream& out, const PoolStatistics& stats) {
+			for(std::size_t i=0; i<stats.workers.size(); ++i) {
+				out << "Worker " << (i+1) << ": " << stats.workers[i] << "\n";
+			}
+			out << "External: " << stats.external << "\n";
+			out << "Idle policy: " << stats.idle << "\n";
+			return out << "Total: " << stats.getTotal() << "\n";
+		}
+
+	};
+
+	/**
+	 * A statistics counter which may be read by any thread. Without statistics support,
+	 * counters are empty and updates are no-ops.
+	 */
+	class StatCounter {
+
+	#ifdef PAREC_ENABLE_STATISTICS
+
+		std::atomic<std::uint64_t> value;
+
+	public:
+
+		StatCounter() : value(0) {}
+
+		/**
+		 * Increments this counter. May only be called by a single thread.
+		 */
+		void add(std::uint64_t n = 1) {
+			value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+		}
+
+		/**
+		 * Increments this counter. May be called by any thread.
+		 */
+		void addShared(std::uint64_t n = 1) {
+			value.fetch_add(n, std::memory_order_relaxed);
+		}
+
+		std::uint64_t get() const {
+			return value.load(std::memory_order_relaxed);
+		}
+
+	#else
+
+	public:
+
+		void add(std::uint64_t = 1) {}
+
+		void addShared(std::uint64_t = 1) {}
+
+		std::uint64_t get() const {
+			return 0;
+		}
+
+	#endif
+
+	};
+
+	/**
+	 * The statistics counters maintained by a worker.
+	 */
+	struct WorkerCounters {
+
+		StatCounter tasks_executed;
+		StatCounter tasks_spawned;
+		StatCounter inline_fallbacks;
+		StatCounter steal_attempts;
+		StatCounter steal_successes;
+		StatCounter spin_time;
+		StatCounter park_time;
+
+		WorkerStatistics get() const {
+			WorkerStatistics res;
+			res.tasks_executed = tasks_executed.get();
+			res.tasks_spawned = tasks_spawned.get();
+			res.inline_fallbacks = inline_fallbacks.get();
+			res.steal_attempts = steal_attempts.get();
+			res.steal_successes = steal_successes.get();
+			res.spin_time = spin_time.get();
+			res.park_time = park_time.get();
+			return res;
+		}
+
+		/**
+		 * Obtains a time stamp in nanoseconds for measuring idle times, or zero if
+		 * statistics are disabled.
+		 */
+		static std::uint64_t now() {
+		#ifdef PAREC_ENABLE_STATISTICS
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		#else
+			return 0;
+		#endif
+		}
+
+	};
+
+} // end namespace runtime
+} // end namespace utils
+} // end namespace parec
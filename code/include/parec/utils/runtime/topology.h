@@ -0,0 +1,249 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace parec {
+namespace utils {
+namespace runtime {
+
+	/**
+	 * The policy for placing the threads of a worker pool on the CPUs of the machine.
+	 */
+	enum class AffinityPolicy {
+
+		/**
+		 * Threads are not pinned to any CPU.
+		 */
+		None,
+
+		/**
+		 * Thread i is pinned to CPU i modulo the number of CPUs, victims are picked at random.
+		 */
+		Linear,
+
+		/**
+		 * Threads are placed on distinct physical cores first and on their SMT siblings
+		 * last. Victims are picked from the closest workers first.
+		 */
+		Topology
+
+	};
+
+	/**
+	 * The location of a logical CPU within the machine.
+	 */
+	struct CpuInfo {
+
+		// the number of the logical CPU
+		int id;
+
+		// the physical core, unique within its package
+		int core;
+
+		// the package (socket) the CPU is located on
+		int package;
+
+		// the NUMA node the CPU belongs to
+		int node;
+
+		// the last level cache domain, identified by its first CPU
+		int cache;
+
+	};
+
+	/**
+	 * A description of the CPUs available to this process, obtained from sysfs.
+	 */
+	class Topology {
+
+		std::vector<CpuInfo> cpus;
+
+	public:
+
+		/**
+		 * The distances between two CPUs, ordered from close to far.
+		 */
+		enum Distance {
+			SameCpu = 0,
+			SameCore = 1,
+			SameCache = 2,
+			SameNode = 3,
+			SamePackage = 4,
+			Remote = 5
+		};
+
+		static const int num_distances = Remote + 1;
+
+		Topology(const std::vector<CpuInfo>& cpus) : cpus(cpus) {}
+
+		/**
+		 * Obtains the topology of the CPUs this process may be scheduled on.
+		 */
+		static Topology detect() {
+			std::vector<int> ids;
+			cpu_set_t mask;
+			CPU_ZERO(&mask);
+			if (sched_getaffinity(0, sizeof(cpu_set_t), &mask) == 0) {
+				for(int i=0; i<CPU_SETSIZE; ++i) {
+					if (CPU_ISSET(i, &mask)) ids.push_back(i);
+				}
+			}
+			if (ids.empty()) {
+				int n = std::max(1u, std::thread::hardware_concurrency());
+				for(int i=0; i<n; ++i) ids.push_back(i);
+			}
+			return read("/sys/devices/system", ids);
+		}
+
+		/**
+		 * Obtains the topology of the given CPUs from a sysfs tree rooted by the given
+		 * directory (usually /sys/devices/system). Missing information is substituted by
+		 * assuming a single package and NUMA node and a core per CPU.
+		 */
+		static Topology read(const std::string& root, const std::vector<int>& ids) {
+
+			// locate NUMA nodes
+			std::map<int,int> nodes;
+			for(int n=0; ; ++n) {
+				std::ifstream in(root + "/node/node" + std::to_string(n) + "/cpulist");
+				if (!in) break;
+				std::string list;
+				std::getline(in, list);
+				for(int cpu : parseCpuList(list)) nodes[cpu] = n;
+			}
+
+			std::vector<CpuInfo> res;
+			for(int id : ids) {
+				std::string dir = root + "/cpu/cpu" + std::to_string(id);
+				CpuInfo info;
+				info.id = id;
+				info.core = readInt(dir + "/topology/core_id", id);
+				info.package = readInt(dir + "/topology/physical_package_id", 0);
+				info.node = nodes.count(id) ? nodes[id] : 0;
+				info.cache = -1;
+
+				// locate the level 3 cache
+				for(int i=0; ; ++i) {
+					std::string cache = dir + "/cache/index" + std::to_string(i);
+					int level = readInt(cache + "/level", -1);
+					if (level < 0) break;
+					if (level != 3) continue;
+					std::ifstream in(cache + "/shared_cpu_list");
+					std::string list;
+					std::getline(in, list);
+					auto shared = parseCpuList(list);
+					if (!shared.empty()) info.cache = shared.front();
+				}
+
+				// without a shared cache, the package is the cache domain
+				if (info.cache < 0) info.cache = -1 - info.package;
+
+				res.push_back(info);
+			}
+			return Topology(res);
+		}
+
+		const std::vector<CpuInfo>& getCpus() const {
+			return cpus;
+		}
+
+		/**
+		 * Obtains the distance between two CPUs of this topology. CPUs on different
+		 * packages are remote, even if they are reported to share a NUMA node (which is
+		 * assumed for all CPUs if there is no NUMA information).
+		 */
+		static Distance getDistance(const CpuInfo& a, const CpuInfo& b) {
+			if (a.id == b.id) return SameCpu;
+			if (a.package == b.package && a.core == b.core) return SameCore;
+			if (a.cache == b.cache) return SameCache;
+			if (a.node == b.node && a.package == b.package) return SameNode;
+			if (a.package == b.package) return SamePackage;
+			return Remote;
+		}
+
+		/**
+		 * Obtains the order in which CPUs should be occupied by threads. CPUs sharing
+		 * caches are kept close to each other, and all physical cores are covered before
+		 * any SMT sibling is used.
+		 */
+		std::vector<CpuInfo> getPlacement() const {
+
+			// sort CPUs by their location
+			auto sorted = cpus;
+			std::stable_sort(sorted.begin(), sorted.end(), [](const CpuInfo& a, const CpuInfo& b) {
+				return std::tie(a.node, a.package, a.cache, a.core, a.id) < std::tie(b.node, b.package, b.cache, b.core, b.id);
+			});
+
+			// number the hardware threads of each core
+			std::vector<int> rank;
+			std::map<std::pair<int,int>,int> count;
+			for(const auto& cur : sorted) {
+				rank.push_back(count[std::make_pair(cur.package, cur.core)]++);
+			}
+
+			// list first threads of all cores first, then the second threads, ...
+			std::vector<CpuInfo> res;
+			for(int r=0; res.size() < sorted.size(); ++r) {
+				for(std::size_t i=0; i<sorted.size(); ++i) {
+					if (rank[i] == r) res.push_back(sorted[i]);
+				}
+			}
+			return res;
+		}
+
+		/**
+		 * Parses a list of CPUs in the sysfs format, e.g. 0-3,8,10-11.
+		 */
+		static std::vector<int> parseCpuList(const std::string& list) {
+			std::vector<int> res;
+			std::stringstream in(list);
+			std::string range;
+			while(std::getline(in, range, ',')) {
+				if (range.empty()) continue;
+				auto pos = range.find('-');
+				int from = std::atoi(range.substr(0,pos).c_str());
+				int to = (pos == std::string::npos) ? from : std::atoi(range.substr(pos+1).c_str());
+				for(int i=from; i<=to; ++i) res.push_back(i);
+			}
+			return res;
+		}
+
+	private:
+
+		static int readInt(const std::string& file, int def) {
+			std::ifstream in(file);
+			int res;
+			if (in >> res) return res;
+			return def;
+		}
+
+	};
+
+	namespace detail {
+
+		/**
+		 * Pins the current thread to the given CPU.
+		 */
+		inline void pinToCpu(int cpu) {
+			cpu_set_t mask;
+			CPU_ZERO(&mask);
+			CPU_SET(cpu, &mask);
+			pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &mask);
+		}
+
+	}
+
+} // end namespace runtime
+} // end namespace utils
+} // end namespace parec
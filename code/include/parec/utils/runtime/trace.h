@@ -0,0 +1,212 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+/**
+ * Task timelines are only recorded if PAREC_ENABLE_TRACING is defined before including
+ * the runtime. Otherwise all trace operations are compiled out.
+ */
+
+namespace parec {
+namespace utils {
+namespace runtime {
+
+	/**
+	 * The kinds of events recorded in a task timeline.
+	 */
+	enum class TraceEventType {
+		TaskBegin,
+		TaskEnd,
+		Spawn,
+		Steal,
+		ParkBegin,
+		ParkEnd
+	};
+
+	/**
+	 * An entry of a task timeline.
+	 */
+	struct TraceEvent {
+
+		// the time stamp in nanoseconds
+		std::uint64_t time;
+
+		// the label of the task the event is associated to
+		const char* label;
+
+		TraceEventType type;
+
+	};
+
+	/**
+	 * A label attached to the tasks spawned within its scope. Tasks inherit the label
+	 * of the thread spawning them, thus it covers whole recursions.
+	 */
+	class TraceLabel {
+
+	#ifdef PAREC_ENABLE_TRACING
+
+		const char* previous;
+
+		static const char*& current() {
+			thread_local static const char* label = nullptr;
+			return label;
+		}
+
+	public:
+
+		explicit TraceLabel(const char* label) : previous(current()) {
+			current() = label;
+		}
+
+		~TraceLabel() {
+			current() = previous;
+		}
+
+		static const char* get() {
+			return current();
+		}
+
+	#else
+
+	public:
+
+		explicit TraceLabel(const char*) {}
+
+		static const char* get() {
+			return nullptr;
+		}
+
+	#endif
+
+		TraceLabel(const TraceLabel&) = delete;
+		TraceLabel& operator=(const TraceLabel&) = delete;
+
+	};
+
+	/**
+	 * A ring buffer of trace events maintained by a single worker. Recording is lock- and
+	 * wait-free; once the buffer is full, the oldest events are overwritten. Without
+	 * tracing support, the buffer is empty and recording is a no-op.
+	 */
+	class TraceBuffer {
+
+	#ifdef PAREC_ENABLE_TRACING
+
+		// the number of retained events, a power of two
+		static const std::size_t capacity = 1 << 16;
+
+		std::vector<TraceEvent> events;
+
+		// the number of events recorded so far
+		std::atomic<std::uint64_t> count;
+
+	public:
+
+		TraceBuffer() : events(capacity), count(0) {}
+
+		/**
+		 * Records an event. May only be called by the owning worker.
+		 */
+		void record(TraceEventType type, const char* label) {
+			auto i = count.load(std::memory_order_relaxed);
+			auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+			events[i & (capacity-1)] = TraceEvent{ std::uint64_t(time), label, type };
+			count.store(i+1, std::memory_order_release);
+		}
+
+		/**
+		 * Visits the retained events, oldest first. Events recorded concurrently may
+		 * not be included.
+		 */
+		template<typename Op>
+		void forEach(const Op& op) const {
+			auto end = count.load(std::memory_order_acquire);
+			auto begin = (end > capacity) ? end - capacity : 0;
+			for(auto i = begin; i<end; ++i) {
+				op(events[i & (capacity-1)]);
+			}
+		}
+
+		void clear() {
+			count.store(0, std::memory_order_relaxed);
+		}
+
+	#else
+
+	public:
+
+		void record(TraceEventType, const char*) {}
+
+		template<typename Op>
+		void forEach(const Op&) const {}
+
+		void clear() {}
+
+	#endif
+
+	};
+
+	/**
+	 * Writes the given string as the content of a JSON string literal, escaping quotes,
+	 * backslashes and control characters.
+	 */
+	inline void writeJsonString(std::ostream& out, const char* str) {
+		static const char* hex = "0123456789abcdef";
+		for(const char* cur = str; *cur; ++cur) {
+			unsigned char c = *cur;
+			if (c == '"' || c == '\\') {
+				out << '\\' << c;
+			} else if (c < 0x20) {
+				out << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+			} else {
+				out << c;
+			}
+		}
+	}
+
+	/**
+	 * Writes the events of the given buffer as Chrome trace events (as accepted by
+	 * chrome://tracing and Perfetto) attributed to the given thread. Events are
+	 * separated by commas, the first one is only preceded by a comma if first is false.
+	 *
+	 * Once the buffer wrapped around, the begin events of the oldest intervals may have
+	 * been overwritten; the end events of those intervals are dropped.
+	 */
+	inline void writeTraceEvents(std::ostream& out, int tid, const TraceBuffer& buffer, bool& first) {
+		// the number of intervals begun but not yet ended
+		std::size_t open = 0;
+		buffer.forEach([&](const TraceEvent& e) {
+			const char* name = e.label ? e.label : "task";
+			const char* phase = "i";
+			switch(e.type) {
+				case TraceEventType::TaskBegin: phase = "B"; break;
+				case TraceEventType::TaskEnd: phase = "E"; break;
+				case TraceEventType::Spawn: name = "spawn"; break;
+				case TraceEventType::Steal: name = "steal"; break;
+				case TraceEventType::ParkBegin: name = "park"; phase = "B"; break;
+				case TraceEventType::ParkEnd: name = "park"; phase = "E"; break;
+			}
+			if (*phase == 'B') open++;
+			if (*phase == 'E') {
+				if (open == 0) return;
+				open--;
+			}
+			if (!first) out << ",\n";
+			first = false;
+			out << "{\"name\":\"";
+			writeJsonString(out, name);
+			out << "\",\"ph\":\"" << phase << "\",\"ts\":" << (e.time / 1000) << "." << (e.time % 1000 / 100) << (e.time % 100 / 10) << (e.time % 10)
+				<< ",\"pid\":0,\"tid\":" << tid;
+			if (*phase == 'i') out << ",\"s\":\"t\"";
+			out << "}";
+		});
+	}
+
+} // end namespace runtime
+} // end namespace utils
+} // end namespace parec
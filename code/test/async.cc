@@ -1,6 +1,10 @@
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <cstdlib>
+#include <stdexcept>
+#include <vector>
+
 #include "parec/async.h"
 
 namespace parec {
@@ -45,4 +49,202 @@ namespace parec {
 
 	}
 
+	TEST(Async, AnyAllOutOfOrder) {
+
+		// the decisive value is located after a long-running operation
+		std::atomic<bool> done(false);
+		auto slow = [&]() {
+			std::atomic<int> sink(0);
+			for(int i=0; i<10000000; i++) sink.store(i, std::memory_order_relaxed);
+			done = true;
+			return true;
+		};
+
+		EXPECT_FALSE(all(async(slow), async([]() { return false; })));
+		EXPECT_TRUE(done);
+
+		done = false;
+		EXPECT_TRUE(any(async(slow), async([]() { return true; })));
+		EXPECT_TRUE(done);
+
+	}
+
+	TEST(Async, AnyAllAsync) {
+
+		EXPECT_TRUE(all_async(
+				async([]() { return true; }),
+				async([]() { return true; }),
+				async([]() { return true; })
+		).get());
+
+		EXPECT_FALSE(all_async(
+				async([]() { return true; }),
+				async([]() { return false; }),
+				async([]() { return true; })
+		).get());
+
+		EXPECT_TRUE(any_async(
+				async([]() { return false; }),
+				async([]() { return false; }),
+				async([]() { return true; })
+		).get());
+
+		EXPECT_FALSE(any_async(
+				async([]() { return false; }),
+				async([]() { return false; })
+		).get());
+
+		// many concurrent decisions
+		std::vector<utils::runtime::Future<bool>> res;
+		for(int i=0; i<100; i++) {
+			res.push_back(any_async(
+					async([=]() { return i % 3 == 0; }),
+					async([=]() { return i % 5 == 0; })
+			));
+		}
+		for(int i=0; i<100; i++) {
+			EXPECT_EQ(i % 3 == 0 || i % 5 == 0, res[i].get()) << "i=" << i;
+		}
+
+	}
+
+	TEST(Async, AnyAllException) {
+
+		auto fail = []()->bool { throw std::runtime_error("failed"); };
+
+		EXPECT_THROW(async(fail).get(), std::runtime_error);
+		EXPECT_THROW(all(async([]() { return true; }), async(fail)), std::runtime_error);
+		EXPECT_THROW(any(async([]() { return false; }), async(fail)), std::runtime_error);
+		EXPECT_THROW(any_async(async(fail), async([]() { return false; })).get(), std::runtime_error);
+
+		EXPECT_THROW(parallel(async(fail), async([]() { return true; })), std::runtime_error);
+
+	}
+
+	TEST(Async, AnyAllCancelledOperands) {
+
+		utils::runtime::PoolConfig config;
+		config.num_workers = 2;
+		utils::runtime::WorkerPool pool(config);
+		utils::runtime::WorkerPool::Scope poolScope(pool);
+
+		auto fail = []()->bool { throw std::runtime_error("failed"); };
+		auto no = []() { return false; };
+		auto yes = []() { return true; };
+
+		// a failing operation abandons the operations spawned after it under the same token
+		auto failing = [&](auto op) {
+			auto token = CancellationToken::create();
+			CancellationScope scope(token);
+			auto a = utils::runtime::spawn(fail);
+			a.wait();
+			auto b = utils::runtime::spawn(op);
+			return std::make_pair(std::move(a), std::move(b));
+		};
+
+		// the abandoned operation does not decide, the failure is reported
+		{
+			auto p = failing(no);
+			EXPECT_THROW(all(std::move(p.second), std::move(p.first)), std::runtime_error);
+		}
+		{
+			auto p = failing(yes);
+			EXPECT_THROW(any(std::move(p.second), std::move(p.first)), std::runtime_error);
+		}
+		{
+			auto p = failing(no);
+			EXPECT_THROW(all_async(std::move(p.second), std::move(p.first)).get(), std::runtime_error);
+		}
+
+		// failures observed after the decision are reported too
+		EXPECT_THROW(all(async(no), async(fail)), std::runtime_error);
+		EXPECT_THROW(any(async(yes), async(fail)), std::runtime_error);
+
+		// abandoned operations alone leave the outcome open
+		{
+			auto token = CancellationToken::create();
+			CancellationScope scope(token);
+			token.cancel();
+			EXPECT_THROW(all(utils::runtime::spawn(yes), utils::runtime::spawn(yes)), operation_cancelled);
+			EXPECT_THROW(any_async(utils::runtime::spawn(no)).get(), operation_cancelled);
+		}
+
+		// failures in recursions deciding on all sub-problems are reported
+		auto check = prec(
+			[](std::pair<int,int> r) { return r.second - r.first <= 1; },
+			[](std::pair<int,int> r)->bool {
+				if (r.first == 37) throw std::runtime_error("failed");
+				return r.first % 2 == 0;
+			},
+			[](std::pair<int,int> r, const auto& f) {
+				auto m = r.first + (r.second - r.first) / 2;
+				return all(f(std::make_pair(r.first, m)), f(std::make_pair(m, r.second)));
+			}
+		);
+		for(int i=0; i<50; i++) {
+			EXPECT_THROW(check(std::make_pair(0, 1024)).get(), std::runtime_error);
+		}
+
+	}
+
+	TEST(Async, ParallelInvoke) {
+
+		std::atomic<int> a(0), b(0), c(0);
+		parallel_invoke([&]() { a++; }, [&]() { b++; }, [&]() { c++; });
+		EXPECT_EQ(1, a);
+		EXPECT_EQ(1, b);
+		EXPECT_EQ(1, c);
+
+		parallel_invoke();
+		parallel_invoke([&]() { a++; });
+		EXPECT_EQ(2, a);
+
+		EXPECT_THROW(parallel_invoke([]() {}, []() { throw std::runtime_error("failed"); }), std::runtime_error);
+
+		// within a cancelled scope, the operations are skipped and reported as cancelled
+		auto token = CancellationToken::create();
+		CancellationScope scope(token);
+		token.cancel();
+		EXPECT_THROW(parallel_invoke([&]() { a++; }, [&]() { b++; }), operation_cancelled);
+		EXPECT_EQ(2, a);
+		EXPECT_EQ(1, b);
+
+	}
+
+	TEST(Async, AnyAllCancellation) {
+
+		// the token is cancelled once the outcome is decided
+		auto token = CancellationToken::create();
+		{
+			CancellationScope scope(token);
+			EXPECT_TRUE(any(token,
+					async([]() { return false; }),
+					async([]() { return true; })
+			));
+		}
+		EXPECT_TRUE(token.isCancelled());
+
+		// the token is not cancelled if all values had to be inspected
+		token = CancellationToken::create();
+		{
+			CancellationScope scope(token);
+			EXPECT_TRUE(all(token,
+					async([]() { return true; }),
+					async([]() { return true; })
+			));
+		}
+		EXPECT_FALSE(token.isCancelled());
+
+		token = CancellationToken::create();
+		{
+			CancellationScope scope(token);
+			EXPECT_FALSE(all_async(token,
+					async([]() { return true; }),
+					async([]() { return false; })
+			).get());
+		}
+		EXPECT_TRUE(token.isCancelled());
+
+	}
+
 } // end namespace parec
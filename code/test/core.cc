@@ -1,9 +1,14 @@
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <chrono>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
 
 #include "parec/core.h"
+#include "parec/futures.h"
 #include "parec/ops.h"
 
 namespace parec {
@@ -383,17 +388,20 @@ namespace parec {
 
 	// ---- application tests --------
 
-	int pfib(int x) {
-		return prec(
-				fun(
-					[](int x) { return x < 2; },
-					[](int x) { return x; },
-					[](int x, const auto& f)->int {
-						auto a = f(x-1);
-						auto b = f(x-2);
-						return a.get() + b.get();
-					}
-				)
+	int pfib(int x, SpawnPolicy policy = SpawnPolicy::Eager) {
+		return parec(
+				group(
+					fun(
+						[](int x) { return x < 2; },
+						[](int x) { return x; },
+						[](int x, const auto& f)->int {
+							auto a = f(x-1);
+							auto b = f(x-2);
+							return a.get() + b.get();
+						}
+					)
+				),
+				policy
 		)(x).get();
 	}
 
@@ -405,6 +413,124 @@ namespace parec {
 
 	}
 
+	TEST(RecOps, Continuations) {
+
+		auto fib = prec(
+				[](int x) { return x < 2; },
+				[](int x) { return x; },
+				[](int x, const auto& f) {
+					auto a = f(x-1);
+					auto b = f(x-2);
+					return utils::runtime::when_all(a,b).then([&]() {
+						return a.get() + b.get();
+					}).get();
+				}
+		);
+
+		EXPECT_EQ(6765, fib(20).get());
+
+		auto twice = prec(
+				[](int x) { return x < 2; },
+				[](int x) { return x; },
+				[](int x, const auto& f) {
+					return f(x-1).then([](int y) { return y + 2; }).get();
+				}
+		);
+
+		EXPECT_EQ(21, twice(11).get());
+
+	}
+
+	TEST(RecOps, FutureSteps) {
+
+		// step cases may return a future on their result instead of waiting for it
+		auto depth = prec(
+				[](int x) { return x < 1; },
+				[](int) { return 0; },
+				[](int x, const auto& f) {
+					return f(x-1).then([](int y) { return y + 1; });
+				}
+		);
+
+		EXPECT_EQ(0, depth(0).get());
+		EXPECT_EQ(10, depth(10).get());
+		EXPECT_EQ(200, depth(200).get());
+
+	}
+
+	TEST(RecOps, CustomPool) {
+
+		utils::runtime::PoolConfig config;
+		config.num_workers = 2;
+		utils::runtime::WorkerPool pool(config);
+
+		utils::runtime::WorkerPool::Scope scope(pool);
+		EXPECT_EQ(6765, pfib(20));
+		EXPECT_EQ(6765, pfib(20, SpawnPolicy::Lazy));
+
+	}
+
+	TEST(RecOps, LazySpawning) {
+
+		EXPECT_EQ(0, pfib(0, SpawnPolicy::Lazy));
+		EXPECT_EQ(1, pfib(1, SpawnPolicy::Lazy));
+		EXPECT_EQ(6765, pfib(20, SpawnPolicy::Lazy));
+		EXPECT_EQ(46368, pfib(24, SpawnPolicy::Lazy));
+
+	}
+
+	TEST(RecOps, Exception) {
+
+		auto fib = prec(
+				[](int x) { return x < 2; },
+				[](int x)->int { if (x == 1) throw std::runtime_error("failed"); return x; },
+				[](int x, const auto& f) {
+					auto a = f(x-1);
+					auto b = f(x-2);
+					return a.get() + b.get();
+				}
+		);
+
+		EXPECT_THROW(fib(20).get(), std::runtime_error);
+		EXPECT_THROW(fib(1).get(), std::runtime_error);
+		EXPECT_EQ(0, fib(0).get());
+
+	}
+
+	TEST(RecOps, ExceptionAbandonsSiblings) {
+
+		utils::runtime::PoolConfig config;
+		config.num_workers = 2;
+		utils::runtime::WorkerPool pool(config);
+		utils::runtime::WorkerPool::Scope scope(pool);
+
+		// a long-running recursion, failing on one of the first branches
+		const int n = 1 << 20;
+		std::atomic<int> leaves(0);
+		auto sum = prec(
+				[](std::pair<int,int> r) { return r.second - r.first <= 1; },
+				[&](std::pair<int,int> r)->int {
+					if (r.first == -1) throw std::runtime_error("failed");
+					leaves++;
+					return 1;
+				},
+				[](std::pair<int,int> r, const auto& f) {
+					auto m = r.first + (r.second - r.first) / 2;
+					auto a = f(std::make_pair(-1, 0));
+					auto b = f(std::make_pair(r.first, m));
+					auto c = f(std::make_pair(m, r.second));
+					return a.get() + b.get() + c.get();
+				}
+		);
+
+		EXPECT_THROW(sum(std::make_pair(0, n)).get(), std::runtime_error);
+		EXPECT_LT(leaves, n);
+
+		// a new invocation is not affected
+		EXPECT_EQ(6765, pfib(20));
+
+	}
+
 	// --- check stack memory usage ---
 
 	struct big_params {
@@ -419,7 +545,7 @@ namespace parec {
 	}
 
 
-	TEST(DISABLED_RecOps, RecursionDepth) {
+	TEST(RecOps, RecursionDepth) {
 
 
 		auto sum = prec(
@@ -435,12 +561,50 @@ namespace parec {
 		sum_seq(N);
 		sum(N).get();
 
+		// waiting within all() is subject to the same limits
+		auto check = prec(
+				[](big_params p) { return p.x == 0; },
+				[](big_params) { return true; },
+				[](big_params p, const auto& rec) {
+					return all(rec(p.x-1), rec(0));
+				}
+		);
+
+		EXPECT_TRUE(check(10).get());
+		EXPECT_TRUE(check(N).get());
+
+		// beyond the nesting limit, workers waiting within all() do not process tasks of
+		// enclosing operations
+		utils::runtime::PoolConfig config;
+		config.num_workers = 1;
+		config.max_nesting = 2;
+		utils::runtime::WorkerPool pool(config);
+
+		utils::runtime::Promise<bool> promise;
+		std::thread t([&]() {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			promise.set(true);
+		});
+		auto f = utils::runtime::spawn(pool, [&]() {
+			std::atomic<bool> other(false);
+			utils::runtime::WorkerPool::getCurrent().submit([&]() { other = true; });
+			auto g = utils::runtime::spawn([&]() {
+				EXPECT_TRUE(all(promise.getFuture()));
+				return bool(other);
+			});
+			bool interleaved = g.get();
+			while (!other) utils::runtime::schedule_step();
+			return interleaved;
+		});
+		EXPECT_FALSE(f.get());
+		t.join();
+
 	}
 
 
 	template<unsigned N>
 	struct static_fib {
-		enum { value = static_fib<N-1>::value + static_fib<N-2>::value };
+		enum { value = int(static_fib<N-1>::value) + int(static_fib<N-2>::value) };
 	};
 
 	template<>
@@ -472,6 +636,10 @@ namespace parec {
 		EXPECT_EQ(static_fib<N>::value, pfib(N));
 	}
 
+	TEST(ScalingTest, ParallelFibLazy) {
+		EXPECT_EQ(static_fib<N>::value, pfib(N, SpawnPolicy::Lazy));
+	}
+
 
 	TEST(DISABLED_WorkerSleepTest, StopAndGo) {
 		// Unfortunately, I don't know a simple, portable way to check the
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "parec/granularity.h"
+#include "parec/ops.h"
+
+namespace parec {
+
+	TEST(Granularity, InitialCutoff) {
+
+		GranularityController controller;
+		EXPECT_EQ(0.0, controller.getElementCost());
+
+		// without measurements, loops are split into about 1000 leaves
+		EXPECT_EQ(1u, controller.getCutoff(10)());
+		EXPECT_EQ(1u, controller.getCutoff(1000)());
+
+		auto threads = utils::runtime::WorkerPool::getCurrent().getNumWorkers() + 1;
+		std::size_t n = 1000 * 1000 * GranularityController::min_leaves_per_thread * threads;
+		EXPECT_EQ(n / 1000, controller.getCutoff(n)());
+
+	}
+
+	TEST(Granularity, Adaptation) {
+
+		GranularityController controller(std::chrono::microseconds(50));
+		std::size_t n = 1 << 30;
+
+		// cheap elements result in large leaves ...
+		controller.record(1000, std::chrono::nanoseconds(5000));
+		EXPECT_EQ(5.0, controller.getElementCost());
+		EXPECT_EQ(10000u, controller.getCutoff(n)());
+
+		// ... but the loop is still split among the threads
+		auto threads = utils::runtime::WorkerPool::getCurrent().getNumWorkers() + 1;
+		std::size_t small = 1000 * GranularityController::min_leaves_per_thread * threads;
+		EXPECT_EQ(1000u, controller.getCutoff(small)());
+
+		// expensive elements result in small leaves
+		for(int i=0; i<50; i++) {
+			controller.record(10, std::chrono::milliseconds(50));
+		}
+		EXPECT_EQ(1u, controller.getCutoff(n)());
+
+		// cutoffs of running loops follow the estimate
+		auto cut = controller.getCutoff(n);
+		for(int i=0; i<100; i++) {
+			controller.record(100, std::chrono::nanoseconds(100));
+		}
+		EXPECT_NEAR(50000.0, double(cut()), 500.0);
+
+	}
+
+	TEST(Granularity, Pfor) {
+
+		// the cutoff learned by one invocation is kept for the next ones
+		std::vector<int> data(100000);
+		for(int i=0; i<5; i++) {
+			pfor(data, [](int& x) { x++; });
+		}
+		for(const auto& cur : data) {
+			EXPECT_EQ(5, cur);
+		}
+
+		// expensive elements are processed correctly as well
+		std::atomic<int> counter(0);
+		for(int i=0; i<3; i++) {
+			pfor(0, 100, [&](int) {
+				counter++;
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+			});
+		}
+		EXPECT_EQ(300, counter);
+
+	}
+
+	TEST(Granularity, Attached) {
+
+		std::vector<int> data(100000);
+		auto inc = [](int& x) { x++; };
+
+		// loops running the same body are tuned independently by their own controllers
+		GranularityController a;
+		GranularityController b;
+		pfor(data, inc, a);
+		EXPECT_LT(0.0, a.getElementCost());
+		EXPECT_EQ(0.0, b.getElementCost());
+		pfor(data.begin(), data.end(), inc, b);
+		EXPECT_LT(0.0, b.getElementCost());
+
+		// the same holds for multi-dimensional loops and reductions
+		GranularityController c;
+		std::array<int,2> lo = {{ 0, 0 }};
+		std::array<int,2> hi = {{ 300, 300 }};
+		pfor(lo, hi, [&](const std::array<int,2>& p) { data[p[0] * 300 + p[1]]++; }, c);
+		EXPECT_LT(0.0, c.getElementCost());
+
+		GranularityController d;
+		auto sum = map_reduce(data,
+			[](int x, int& res) { res += x; },
+			[](int x, int y) { return x + y; },
+			[]() { return 0; },
+			[](int x) { return x; },
+			d
+		);
+		EXPECT_EQ(2 * 100000 + 300 * 300, sum);
+		EXPECT_LT(0.0, d.getElementCost());
+
+	}
+
+} // end namespace parec
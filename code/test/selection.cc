@@ -0,0 +1,182 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "parec/core.h"
+#include "parec/selection.h"
+
+namespace parec {
+
+	TEST(Selection, InputSize) {
+
+		EXPECT_EQ(12u, detail::input_size(12));
+		EXPECT_EQ(0u, detail::input_size(-3));
+		EXPECT_EQ(3u, detail::input_size(std::vector<int>({ 1, 2, 3 })));
+		EXPECT_EQ(5u, detail::input_size(std::make_pair(2,7)));
+
+		std::vector<int> v(10);
+		EXPECT_EQ(10u, detail::input_size(std::make_pair(v.begin(), v.end())));
+
+		struct opaque {};
+		EXPECT_EQ(0u, detail::input_size(opaque()));
+
+	}
+
+	TEST(Selection, Buckets) {
+
+		EXPECT_EQ(0u, VersionTuner::getBucket(0));
+		EXPECT_EQ(1u, VersionTuner::getBucket(1));
+		EXPECT_EQ(2u, VersionTuner::getBucket(2));
+		EXPECT_EQ(2u, VersionTuner::getBucket(3));
+		EXPECT_EQ(11u, VersionTuner::getBucket(1024));
+		EXPECT_EQ(VersionTuner::num_buckets - 1, VersionTuner::getBucket(~std::size_t(0)));
+
+	}
+
+	TEST(Selection, RandomAndRoundRobin) {
+
+		bool measure;
+
+		// random choices cover all versions
+		VersionTuner random(3, SelectionPolicy::Random);
+		std::vector<int> hits(3);
+		for(int i=0; i<300; i++) hits[random.choose(10, measure)]++;
+		for(int cur : hits) EXPECT_LT(0, cur);
+		EXPECT_FALSE(measure);
+
+		// round robin choices alternate
+		VersionTuner rr(3, SelectionPolicy::RoundRobin);
+		for(unsigned i=0; i<10; i++) {
+			EXPECT_EQ(i % 3, rr.choose(10, measure));
+		}
+
+	}
+
+	TEST(Selection, Autotune) {
+
+		bool measure;
+		VersionTuner tuner(2, SelectionPolicy::Autotune);
+
+		// all versions are timed first
+		for(int i=0; i<int(2*VersionTuner::min_samples); i++) {
+			auto v = tuner.choose(100, measure);
+			EXPECT_TRUE(measure);
+			tuner.record(100, v, std::chrono::nanoseconds(v == 1 ? 10 : 1000));
+		}
+
+		// afterwards, the faster version is chosen for inputs of this size
+		EXPECT_EQ(1u, tuner.getBest(100));
+		int fast = 0;
+		for(int i=0; i<1000; i++) {
+			if (tuner.choose(100, measure) == 1) fast++;
+		}
+		EXPECT_LT(900, fast);
+
+		// calls which are not timed get the fastest version
+		EXPECT_EQ(1u, tuner.choose(100));
+
+		// other sizes are tuned independently
+		EXPECT_EQ(0u, tuner.getBest(1));
+
+		// the measurements are reported
+		auto stats = tuner.getStatistics();
+		ASSERT_EQ(2u, stats.size());
+		EXPECT_EQ(VersionTuner::getBucket(100), stats[0].bucket);
+		EXPECT_EQ(1000u, stats[0].average_time);
+		EXPECT_FALSE(stats[0].best);
+		EXPECT_EQ(10u, stats[1].average_time);
+		EXPECT_TRUE(stats[1].best);
+
+		std::stringstream out;
+		out << tuner;
+		EXPECT_NE(std::string::npos, out.str().find("autotune")) << out.str();
+		EXPECT_NE(std::string::npos, out.str().find("(best)")) << out.str();
+
+	}
+
+	TEST(Selection, AutotunedPick) {
+
+		std::atomic<int> slow(0);
+		std::atomic<int> fast(0);
+
+		// two versions of a base case, one of them being slow
+		auto def = fun(
+			[](int x) { return x < 1; },
+			pick(
+				[&](int x) {
+					slow++;
+					std::this_thread::sleep_for(std::chrono::microseconds(200));
+					return x;
+				},
+				[&](int x) {
+					fast++;
+					return x;
+				}
+			),
+			[](int x, const auto& f) { return f(x-1).get() + 1; }
+		);
+		def.setSelectionPolicy(SelectionPolicy::Autotune);
+		auto count = prec(def);
+
+		for(int i=0; i<200; i++) {
+			EXPECT_EQ(0, count(0).get());
+		}
+
+		// the tuner converged on the fast version
+		ASSERT_TRUE(def.getBaseCaseTuner());
+		EXPECT_EQ(1u, def.getBaseCaseTuner()->getBest(0));
+		EXPECT_LT(slow * 4, fast);
+
+		// step cases without alternatives are not tracked
+		EXPECT_FALSE(def.getStepCaseTuner());
+
+	}
+
+	TEST(Selection, AutotunedStepCases) {
+
+		std::atomic<int> slow(0);
+		std::atomic<int> fast(0);
+
+		// step cases are timed when processed sequentially, thus without workers
+		utils::runtime::PoolConfig config;
+		config.num_workers = 0;
+		utils::runtime::WorkerPool pool(config);
+		utils::runtime::WorkerPool::Scope scope(pool);
+
+		// two versions of a step case, one of them being slow
+		auto def = fun(
+			[](int x) { return x < 1; },
+			[](int x) { return x; },
+			pick(
+				[&](int x, const auto& f) {
+					slow++;
+					std::this_thread::sleep_for(std::chrono::microseconds(200));
+					return f(x-1).get() + 1;
+				},
+				[&](int x, const auto& f) {
+					fast++;
+					return f(x-1).get() + 1;
+				}
+			)
+		);
+		def.setSelectionPolicy(SelectionPolicy::Autotune);
+		auto count = prec(def);
+
+		for(int i=0; i<200; i++) {
+			EXPECT_EQ(2, count(2).get());
+		}
+
+		// the tuner converged on the fast version for both input sizes
+		ASSERT_TRUE(def.getStepCaseTuner());
+		EXPECT_EQ(1u, def.getStepCaseTuner()->getBest(1));
+		EXPECT_EQ(1u, def.getStepCaseTuner()->getBest(2));
+		EXPECT_LT(slow * 4, fast);
+
+	}
+
+} // end namespace parec
@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "parec/utils/runtime/runtime.h"
+
+namespace parec {
+namespace utils {
+
+	using namespace runtime;
+
+	TEST(Cancellation, Token) {
+
+		CancellationToken none;
+		EXPECT_FALSE(none.isCancelled());
+		none.cancel();
+		EXPECT_FALSE(none.isCancelled());
+
+		auto token = CancellationToken::create();
+		auto copy = token;
+		EXPECT_FALSE(copy.isCancelled());
+		token.cancel();
+		EXPECT_TRUE(copy.isCancelled());
+
+	}
+
+	TEST(Cancellation, Scope) {
+
+		EXPECT_FALSE(isCancelled());
+
+		auto parent = CancellationToken::create();
+		{
+			CancellationScope outer(parent);
+			EXPECT_FALSE(isCancelled());
+
+			// tokens created within a scope are cancelled along with the scope's token
+			auto child = CancellationToken::create();
+			auto other = CancellationToken::create();
+			{
+				CancellationScope inner(child);
+				EXPECT_FALSE(isCancelled());
+				child.cancel();
+				EXPECT_TRUE(isCancelled());
+			}
+			EXPECT_FALSE(isCancelled());
+			EXPECT_FALSE(other.isCancelled());
+
+			parent.cancel();
+			EXPECT_TRUE(isCancelled());
+			EXPECT_TRUE(other.isCancelled());
+		}
+		EXPECT_FALSE(isCancelled());
+
+	}
+
+	TEST(Cancellation, Inheritance) {
+
+		PoolConfig config;
+		config.num_workers = 2;
+		WorkerPool pool(config);
+
+		auto token = CancellationToken::create();
+		CancellationScope scope(token);
+
+		// spawned tasks observe the token of their creator
+		auto f = spawn(pool, []() {
+			auto g = spawn([]() { return CancellationToken::getCurrent().isCancelled(); });
+			return !isCancelled() && !g.get();
+		});
+		EXPECT_TRUE(f.get());
+
+		// operations spawned after the cancellation are skipped
+		token.cancel();
+		std::atomic<int> counter(0);
+		auto h = spawn(pool, [&]() { counter++; return 12; });
+		EXPECT_THROW(h.get(), operation_cancelled);
+		auto v = spawn(pool, [&]() { counter++; });
+		EXPECT_THROW(v.get(), operation_cancelled);
+		auto n = spawn_n(pool, 4, [&](std::size_t) { counter++; });
+		EXPECT_THROW(n.get(), operation_cancelled);
+		EXPECT_EQ(0, counter);
+
+		// so are the operations of task groups, which are reported by wait
+		TaskGroup group(pool);
+		group.run([&]() { counter++; });
+		EXPECT_THROW(group.wait(), operation_cancelled);
+		EXPECT_THROW(group.runAndWait([&]() { counter++; }), operation_cancelled);
+		EXPECT_EQ(0, counter);
+
+	}
+
+	TEST(Cancellation, Outcome) {
+
+		EXPECT_TRUE(isCancellation(std::make_exception_ptr(operation_cancelled())));
+		EXPECT_FALSE(isCancellation(std::make_exception_ptr(std::runtime_error("failed"))));
+		EXPECT_FALSE(isCancellation(std::exception_ptr()));
+
+		PoolConfig config;
+		config.num_workers = 2;
+		WorkerPool pool(config);
+
+		auto token = CancellationToken::create();
+		CancellationScope scope(token);
+
+		// a failure cancels the siblings of the failing operation ...
+		auto a = spawn(pool, []()->bool { throw std::runtime_error("failed"); });
+		EXPECT_THROW(a.get(), std::runtime_error);
+		EXPECT_TRUE(token.isCancelled());
+
+		// ... whose results can be told apart from actual values
+		auto b = spawn(pool, []() { return false; });
+		EXPECT_THROW(b.get(), operation_cancelled);
+
+	}
+
+	TEST(Cancellation, TaskGroupFailure) {
+
+		PoolConfig config;
+		config.num_workers = 1;
+		WorkerPool pool(config);
+
+		auto token = CancellationToken::create();
+		CancellationScope scope(token);
+
+		// operations skipped due to a failure report the failure
+		std::atomic<int> counter(0);
+		TaskGroup group(pool);
+		group.run([]() { throw std::runtime_error("failed"); });
+		while(!token.isCancelled()) {}
+		group.run([&]() { counter++; });
+		EXPECT_THROW(group.wait(), std::runtime_error);
+		EXPECT_EQ(0, counter);
+
+	}
+
+	TEST(Cancellation, DiscardQueuedTasks) {
+
+		PoolConfig config;
+		config.num_workers = 1;
+		WorkerPool pool(config);
+
+		// block the only worker
+		std::atomic<bool> blocked(true);
+		std::atomic<bool> started(false);
+		auto blocker = spawn(pool, [&]() {
+			started = true;
+			while(blocked) {}
+		});
+		while(!started) {}
+
+		// queue up some tasks under a token
+		std::atomic<int> counter(0);
+		std::vector<Future<int>> futures;
+		auto token = CancellationToken::create();
+		{
+			CancellationScope scope(token);
+			for(int i=0; i<10; i++) {
+				futures.push_back(spawn(pool, [&]() { counter++; return 1; }));
+			}
+		}
+
+		// cancel them before they are processed
+		token.cancel();
+		blocked = false;
+		blocker.get();
+
+		// their futures report the cancellation instead of a value
+		for(auto& cur : futures) {
+			EXPECT_THROW(cur.get(), operation_cancelled);
+		}
+		EXPECT_EQ(0, counter);
+
+	}
+
+} // end namespace utils
+} // end namespace parec
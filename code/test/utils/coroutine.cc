@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+#include "parec/core.h"
+#include "parec/utils/runtime/coroutine.h"
+
+namespace parec {
+namespace utils {
+
+	using namespace runtime;
+
+	TEST(Coroutine, ForwardedResults) {
+
+		PoolConfig config;
+		config.num_workers = 2;
+		WorkerPool pool(config);
+
+		// tasks may produce a future on their result instead of the result itself
+		Promise<int> p;
+		auto f = spawn(pool, []() { return 0; }, [&]() { return p.getFuture(); });
+		p.set(5);
+		EXPECT_EQ(5, f.get());
+
+		Promise<void> q;
+		auto g = spawn(pool, []() {}, [&]() { return q.getFuture(); });
+		q.set();
+		g.get();
+
+		// failures are forwarded too
+		Promise<int> r;
+		auto h = spawn(pool, []() { return 0; }, [&]() { return r.getFuture(); });
+		r.setException(std::make_exception_ptr(std::runtime_error("failed")));
+		EXPECT_THROW(h.get(), std::runtime_error);
+
+	}
+
+#ifdef PAREC_HAS_COROUTINES
+
+	namespace {
+
+		Future<int> addOne(const Future<int>& value) {
+			co_return co_await value + 1;
+		}
+
+		Future<void> increment(WorkerPool& pool, int& counter) {
+			co_await spawn(pool, [&]() { counter++; });
+			counter++;
+		}
+
+		Future<int> fail(WorkerPool& pool) {
+			int x = co_await spawn(pool, []() { return 1; });
+			if (x == 1) throw std::runtime_error("failed");
+			co_return x;
+		}
+
+	}
+
+	TEST(Coroutine, Await) {
+
+		// awaiting ready futures does not suspend
+		Future<int> ready(1);
+		EXPECT_EQ(2, addOne(ready).get());
+
+		// awaiting pending futures suspends the coroutine; the awaited future has to
+		// outlive the suspension
+		Promise<int> p;
+		auto value = p.getFuture();
+		auto f = addOne(value);
+		EXPECT_FALSE(f.isDone());
+		p.set(11);
+		EXPECT_TRUE(f.isDone());
+		EXPECT_EQ(12, f.get());
+
+	}
+
+	TEST(Coroutine, Tasks) {
+
+		PoolConfig config;
+		config.num_workers = 2;
+		WorkerPool pool(config);
+
+		int counter = 0;
+		increment(pool, counter).get();
+		EXPECT_EQ(2, counter);
+
+		EXPECT_THROW(fail(pool).get(), std::runtime_error);
+
+	}
+
+	TEST(Coroutine, StepCases) {
+
+		PoolConfig config;
+		config.num_workers = 2;
+		WorkerPool pool(config);
+		WorkerPool::Scope scope(pool);
+
+		// step cases suspend instead of waiting for their sub-problems
+		auto fib = prec(
+				[](int x) { return x < 2; },
+				[](int x) { return x; },
+				[](int x, auto f)->Future<int> {
+					auto a = f(x-1);
+					auto b = f(x-2);
+					co_return co_await a + co_await b;
+				}
+		);
+
+		EXPECT_EQ(1, fib(1).get());
+		EXPECT_EQ(6765, fib(20).get());
+		EXPECT_EQ(46368, fib(24).get());
+
+	}
+
+#endif
+
+} // end namespace utils
+} // end namespace parec
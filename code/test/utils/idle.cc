@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+#include "parec/utils/runtime/idle.h"
+
+namespace parec {
+namespace utils {
+
+	using namespace runtime;
+
+	TEST(IdlePolicy, Presets) {
+
+		auto latency = IdlePolicy::latency();
+		auto balanced = IdlePolicy::balanced();
+		auto batch = IdlePolicy::batch();
+
+		// latency-critical workers are searching for longer
+		EXPECT_LT(balanced.spin_cycles, latency.spin_cycles);
+		EXPECT_LT(batch.spin_cycles, balanced.spin_cycles);
+		EXPECT_TRUE(latency.backoff);
+
+		// all of them eventually sleep
+		EXPECT_TRUE(latency.park);
+		EXPECT_TRUE(balanced.park);
+		EXPECT_TRUE(batch.park);
+
+		// presets may be obtained by name
+		EXPECT_EQ(latency.spin_cycles, IdlePolicy::fromName("latency").spin_cycles);
+		EXPECT_EQ(batch.spin_cycles, IdlePolicy::fromName("batch").spin_cycles);
+		EXPECT_EQ(balanced.spin_cycles, IdlePolicy::fromName("unknown").spin_cycles);
+
+	}
+
+	TEST(IdlePolicy, Print) {
+
+		IdlePolicy policy;
+		policy.spin_cycles = 5;
+		policy.backoff = true;
+		policy.max_backoff = 8;
+		policy.yield_cycles = 3;
+		policy.park_timeout = std::chrono::microseconds(100);
+
+		std::stringstream out;
+		out << policy;
+		EXPECT_EQ("spin 5 (backoff up to 8), yield 3, park for 100us", out.str());
+
+		policy.park = false;
+		out.str("");
+		out << policy;
+		EXPECT_EQ("spin 5 (backoff up to 8), yield 3, no parking", out.str());
+
+	}
+
+} // end namespace utils
+} // end namespace parec
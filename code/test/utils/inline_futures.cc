@@ -0,0 +1,204 @@
+#include <gtest/gtest.h>
+
+#define PAREC_INLINE_FUTURES
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "parec/utils/runtime/runtime.h"
+
+namespace parec {
+namespace utils {
+
+	using namespace runtime;
+
+	TEST(InlineFutures, Basic) {
+
+		Future<int> a;
+		EXPECT_TRUE(a.isDone());
+
+		Future<int> b(12);
+		EXPECT_TRUE(b.isDone());
+		EXPECT_EQ(12, b.get());
+
+		Promise<int> p;
+		auto f = p.getFuture();
+		EXPECT_FALSE(f.isDone());
+		p.set(5);
+		EXPECT_TRUE(f.isDone());
+		EXPECT_EQ(5, f.get());
+		EXPECT_EQ(5, f.extract());
+
+		Promise<void> q;
+		auto g = q.getFuture();
+		EXPECT_FALSE(g.isDone());
+		q.set();
+		EXPECT_TRUE(g.isDone());
+		g.get();
+
+	}
+
+	TEST(InlineFutures, LinkMigration) {
+
+		// the result follows the future through moves
+		Promise<int> p;
+		auto f = p.getFuture();
+		Future<int> g = std::move(f);
+		EXPECT_TRUE(f.isDone());
+		Future<int> h;
+		h = std::move(g);
+
+		// and the promise may move too
+		Promise<int> q(std::move(p));
+		q.set(7);
+		EXPECT_TRUE(h.isDone());
+		EXPECT_EQ(7, h.get());
+
+		// results obtained after the completion
+		Promise<int> r;
+		r.set(3);
+		EXPECT_EQ(3, r.getFuture().get());
+
+		// futures of abandoned promises never get ready
+		Future<int> orphan;
+		{
+			Promise<int> s;
+			orphan = s.getFuture();
+		}
+		EXPECT_FALSE(orphan.isDone());
+
+		// promises of discarded futures may still be set
+		Promise<int> t;
+		t.getFuture();
+		t.set(1);
+
+	}
+
+	TEST(InlineFutures, ConcurrentMoves) {
+
+		// move a future around while its value is being set
+		for(int i=0; i<1000; i++) {
+			Promise<int> p;
+			std::vector<Future<int>> futures;
+			futures.push_back(p.getFuture());
+			std::thread t([&]() { p.set(i); });
+			for(int j=0; j<20; j++) {
+				futures.push_back(std::move(futures.back()));
+			}
+			t.join();
+			EXPECT_EQ(i, futures.back().get());
+		}
+
+	}
+
+	TEST(InlineFutures, Continuations) {
+
+		// continuations outlive the future they have been registered at
+		int calls = 0;
+		Promise<int> p;
+		{
+			auto f = p.getFuture();
+			f.onReady([&]() { calls++; });
+		}
+		p.set(1);
+		EXPECT_EQ(1, calls);
+
+		// chains of continuations
+		auto g = spawn([]() { return 1; })
+				.then([](int x) { return x + 1; })
+				.then([](int x) { return x * 10; });
+		EXPECT_EQ(20, g.get());
+
+		Promise<void> q;
+		auto h = q.getFuture().then([]() { return 3; });
+		EXPECT_FALSE(h.isDone());
+		q.set();
+		EXPECT_EQ(3, h.get());
+
+		// combinators
+		std::vector<Future<int>> futures;
+		for(int i=0; i<100; i++) {
+			futures.push_back(spawn([i]() { return i; }));
+		}
+		when_all(futures).get();
+		int sum = 0;
+		for(const auto& cur : futures) sum += cur.get();
+		EXPECT_EQ(4950, sum);
+
+	}
+
+	TEST(InlineFutures, Exception) {
+
+		Promise<int> p;
+		auto f = p.getFuture();
+		p.setException(std::make_exception_ptr(std::runtime_error("failed")));
+		EXPECT_TRUE(f.isDone());
+		EXPECT_THROW(f.get(), std::runtime_error);
+
+		PoolConfig config;
+		config.num_workers = 2;
+		WorkerPool pool(config);
+
+		auto g = spawn(pool, []()->int { throw std::runtime_error("failed"); });
+		EXPECT_THROW(g.get(), std::runtime_error);
+
+		auto h = spawn(pool, []()->int { throw std::runtime_error("failed"); }).then([](int x) { return x; });
+		EXPECT_THROW(h.get(), std::runtime_error);
+
+		// forwarded futures
+		Promise<int> q;
+		auto i = spawn(pool, []() { return 0; }, [&]() { return q.getFuture(); });
+		q.set(4);
+		EXPECT_EQ(4, i.get());
+
+	}
+
+	namespace {
+
+		int fib(int n) {
+			if (n < 2) return n;
+			auto a = spawn([n]() { return fib(n-1); });
+			auto b = spawn([n]() { return fib(n-2); });
+			return a.get() + b.get();
+		}
+
+	}
+
+	TEST(InlineFutures, MoveOnly) {
+
+		// move-only values are moved into the future, also through forwarded futures
+		Promise<std::unique_ptr<int>> p;
+		auto f = p.getFuture();
+		auto g = std::move(f);
+		p.set(std::unique_ptr<int>(new int(1)));
+		EXPECT_EQ(1, *g.extract());
+
+		Promise<std::unique_ptr<int>> q;
+		Promise<std::unique_ptr<int>> r;
+		auto h = r.getFuture();
+		r.forward(q.getFuture());
+		q.set(std::unique_ptr<int>(new int(2)));
+		EXPECT_EQ(2, *h.extract());
+
+		// values obtained after the completion are moved out of the promise
+		Promise<std::unique_ptr<int>> s;
+		s.set(std::unique_ptr<int>(new int(3)));
+		EXPECT_EQ(3, *s.getFuture().extract());
+
+	}
+
+	TEST(InlineFutures, Fib) {
+
+		PoolConfig config;
+		config.num_workers = 3;
+		WorkerPool pool(config);
+
+		EXPECT_EQ(6765, spawn(pool, []() { return fib(20); }).get());
+
+	}
+
+} // end namespace utils
+} // end namespace parec
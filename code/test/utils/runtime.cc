@@ -1,5 +1,12 @@
 #include <gtest/gtest.h>
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <thread>
 #include <vector>
 #include "parec/utils/runtime/runtime.h"
 
@@ -43,140 +50,1158 @@ namespace utils {
 
 	}
 
-	TEST(TaskQueue, Basic) {
+	TEST(WorkerPool, Config) {
 
-		runtime::SimpleQueue<int,3> queue;
+		runtime::PoolConfig config;
+		config.num_workers = 2;
+		config.affinity = runtime::AffinityPolicy::None;
 
-		EXPECT_TRUE(queue.empty());
-		EXPECT_FALSE(queue.full());
+		runtime::WorkerPool pool(config);
+		EXPECT_EQ(2, pool.getNumWorkers());
 
-		std::cout << queue << "\n";
+		// tasks are processed by the workers of the given pool
+		auto f = runtime::spawn(pool, []() {
+			runtime::Worker* worker = runtime::getCurrentWorker();
+			return worker ? &worker->pool : nullptr;
+		});
+		EXPECT_EQ(&pool, f.get());
 
-		EXPECT_TRUE(queue.push_front(12));
-		std::cout << queue << "\n";
-		EXPECT_FALSE(queue.empty());
-		EXPECT_FALSE(queue.full());
+		// the default pool is not affected
+		EXPECT_NE(&pool, &runtime::WorkerPool::getInstance());
 
-		EXPECT_EQ(12, queue.pop_front());
-		std::cout << queue << "\n";
+	}
 
-		EXPECT_TRUE(queue.empty());
-		EXPECT_FALSE(queue.full());
+	TEST(WorkerPool, Scope) {
 
-		EXPECT_TRUE(queue.push_front(12));
+		runtime::PoolConfig config;
+		config.num_workers = 1;
+		runtime::WorkerPool pool(config);
 
-		EXPECT_FALSE(queue.empty());
-		EXPECT_FALSE(queue.full());
+		EXPECT_EQ(&runtime::WorkerPool::getInstance(), &runtime::WorkerPool::getCurrent());
+		{
+			runtime::WorkerPool::Scope scope(pool);
+			EXPECT_EQ(&pool, &runtime::WorkerPool::getCurrent());
 
-		std::cout << queue << "\n";
-		EXPECT_EQ(12, queue.pop_back());
-		std::cout << queue << "\n";
+			// nested spawns stay within the pool
+			auto f = runtime::spawn([]() {
+				auto g = runtime::spawn([]() { return &runtime::getCurrentWorker()->pool; });
+				return g.get() == &runtime::getCurrentWorker()->pool;
+			});
+			EXPECT_TRUE(f.get());
+		}
+		EXPECT_EQ(&runtime::WorkerPool::getInstance(), &runtime::WorkerPool::getCurrent());
 
 	}
 
-	TEST(TaskQueue, Order) {
+	TEST(WorkerPool, Isolation) {
 
+		runtime::PoolConfig config;
+		config.num_workers = 2;
+		config.idle.spin_cycles = 10;
+		runtime::WorkerPool a(config);
 
-		runtime::SimpleQueue<int,3> queue;
+		config.idle.park = false;
+		runtime::WorkerPool b(config);
 
-		// fill queue in the front
-		EXPECT_FALSE(queue.full());
-		EXPECT_TRUE(queue.push_front(1)) << queue;
-		EXPECT_FALSE(queue.full());
-		EXPECT_TRUE(queue.push_front(2)) << queue;
-		EXPECT_FALSE(queue.full());
-		EXPECT_TRUE(queue.push_front(3)) << queue;
-		EXPECT_TRUE(queue.full());
-		EXPECT_FALSE(queue.push_front(4)) << queue;
-		EXPECT_TRUE(queue.full());
+		std::atomic<int> wrong(0);
+		std::vector<runtime::Future<void>> futures;
+		for(int i=0; i<100; i++) {
+			futures.push_back(runtime::spawn(a, [&]() { if (&runtime::getCurrentWorker()->pool != &a) wrong++; }));
+			futures.push_back(runtime::spawn(b, [&]() { if (&runtime::getCurrentWorker()->pool != &b) wrong++; }));
+		}
+		for(auto& cur : futures) cur.get();
+
+		EXPECT_EQ(0, wrong);
+
+	}
+
+	TEST(WorkerPool, Resize) {
+
+		runtime::PoolConfig config;
+		config.num_workers = 1;
+		runtime::WorkerPool pool(config);
+
+		auto sum = [&]() {
+			std::vector<runtime::Future<int>> futures;
+			for(int i=0; i<100; i++) {
+				futures.push_back(runtime::spawn(pool, [i]() { return i; }));
+			}
+			int res = 0;
+			for(auto& cur : futures) res += cur.get();
+			return res;
+		};
+
+		EXPECT_EQ(4950, sum());
+
+		pool.resize(3);
+		EXPECT_EQ(3, pool.getNumWorkers());
+		EXPECT_EQ(4950, sum());
+
+		pool.resize(0);
+		EXPECT_EQ(0, pool.getNumWorkers());
+		EXPECT_EQ(4950, sum());
+
+		pool.resize(2);
+		EXPECT_EQ(2, pool.getNumWorkers());
+		EXPECT_EQ(4950, sum());
+
+	}
+
+	TEST(Future, OnReady) {
+
+		runtime::Promise<int> p;
+		auto f = p.getFuture();
+
+		int calls = 0;
+		f.onReady([&]() { calls++; });
+		f.onReady([&]() { calls++; });
+		EXPECT_EQ(0, calls);
+
+		p.set(12);
+		EXPECT_EQ(2, calls);
+
+		// registered after completion => run immediately
+		f.onReady([&]() { calls++; });
+		EXPECT_EQ(3, calls);
+
+	}
+
+	TEST(Future, Then) {
+
+		// a chain of continuations
+		auto f = runtime::spawn([]() { return 1; })
+				.then([](int x) { return x + 1; })
+				.then([](int x) { return x * 10; });
+		EXPECT_EQ(20, f.get());
+
+		// continuations on ready and void futures
+		int x = 0;
+		runtime::Future<int> ready(5);
+		auto g = ready.then([&](int v) { x = v; });
+		g.get();
+		EXPECT_EQ(5, x);
+
+		auto h = runtime::spawn([&]() { x++; }).then([&]() { return x; });
+		EXPECT_EQ(6, h.get());
+
+		// continuations registered before completion
+		runtime::Promise<int> p;
+		auto i = p.getFuture().then([](int v) { return v * 2; });
+		EXPECT_FALSE(i.isDone());
+		p.set(21);
+		EXPECT_EQ(42, i.get());
+
+	}
+
+	TEST(Future, WhenAll) {
+
+		std::vector<runtime::Future<int>> futures;
+		for(int i=0; i<100; i++) {
+			futures.push_back(runtime::spawn([i]() { return i; }));
+		}
+
+		auto sum = runtime::when_all(futures).then([&]() {
+			int res = 0;
+			for(const auto& cur : futures) {
+				EXPECT_TRUE(cur.isDone());
+				res += cur.get();
+			}
+			return res;
+		});
+		EXPECT_EQ(4950, sum.get());
+
+		// empty and mixed cases
+		runtime::when_all(std::vector<runtime::Future<int>>()).get();
+
+		runtime::Promise<int> p;
+		auto a = p.getFuture();
+		auto b = runtime::spawn([]() {});
+		auto all = runtime::when_all(a, b);
+		EXPECT_FALSE(all.isDone());
+		p.set(1);
+		all.get();
+
+	}
+
+	TEST(Future, WhenAny) {
+
+		runtime::Promise<int> a;
+		runtime::Promise<int> b;
+		runtime::Promise<void> c;
+
+		auto fa = a.getFuture();
+		auto fb = b.getFuture();
+		auto fc = c.getFuture();
+
+		auto any = runtime::when_any(fa, fb, fc);
+		EXPECT_FALSE(any.isDone());
+		b.set(2);
+		EXPECT_EQ(1, any.get());
+		a.set(1);
+		c.set();
+
+		std::vector<runtime::Future<int>> futures;
+		futures.push_back(runtime::Future<int>());
+		futures.push_back(runtime::spawn([]() { return 1; }));
+		EXPECT_EQ(0, runtime::when_any(futures).get());
+
+		EXPECT_EQ(0, runtime::when_any(std::vector<runtime::Future<int>>()).get());
+
+	}
+
+	TEST(Future, Exception) {
+
+		// exceptions are delivered through the shared state
+		runtime::Promise<int> p;
+		auto f = p.getFuture();
+		p.setException(std::make_exception_ptr(std::runtime_error("failed")));
+		EXPECT_TRUE(f.isDone());
+		EXPECT_THROW(f.get(), std::runtime_error);
+
+		// exceptions raised by tasks are rethrown by get
+		runtime::PoolConfig config;
+		config.num_workers = 2;
+		runtime::WorkerPool pool(config);
+
+		auto g = runtime::spawn(pool, []()->int { throw std::runtime_error("failed"); });
+		EXPECT_THROW(g.get(), std::runtime_error);
+
+		auto h = runtime::spawn(pool, []() { throw std::logic_error("failed"); });
+		EXPECT_THROW(h.get(), std::logic_error);
+
+		// continuations of failed futures fail too
+		int calls = 0;
+		auto i = runtime::spawn(pool, []()->int { throw std::runtime_error("failed"); }).then([&](int x) { calls++; return x; });
+		EXPECT_THROW(i.get(), std::runtime_error);
+		auto j = runtime::spawn(pool, []() { return 1; }).then([](int)->int { throw std::logic_error("failed"); });
+		EXPECT_THROW(j.get(), std::logic_error);
+		EXPECT_EQ(0, calls);
+
+		// the pool is still functional
+		EXPECT_EQ(3, runtime::spawn(pool, []() { return 3; }).get());
+
+	}
+
+	TEST(Future, MoveOnly) {
+
+		// move-only values are passed through promises and futures
+		runtime::Promise<std::unique_ptr<int>> p;
+		auto f = p.getFuture();
+		p.set(std::unique_ptr<int>(new int(1)));
+		EXPECT_EQ(1, *f.get());
+		EXPECT_EQ(1, *f.extract());
+
+		runtime::Immediate<std::unique_ptr<int>> i(std::unique_ptr<int>(new int(2)));
+		EXPECT_EQ(2, *i.extract());
+
+		runtime::PoolConfig config;
+		config.num_workers = 2;
+		runtime::WorkerPool pool(config);
+
+		auto g = runtime::spawn(pool, []() { return std::unique_ptr<int>(new int(3)); });
+		EXPECT_EQ(3, *g.extract());
+
+		runtime::Promise<std::unique_ptr<int>> q;
+		auto h = q.getFuture();
+		q.forward(runtime::spawn(pool, []() { return std::unique_ptr<int>(new int(4)); }));
+		EXPECT_EQ(4, *h.extract());
+
+	}
+
+	namespace {
+
+		// counts the copies of its instances
+		struct copy_counter {
+
+			static std::atomic<int> copies;
+
+			copy_counter() {}
+
+			copy_counter(const copy_counter&) { copies++; }
+
+			copy_counter(copy_counter&&) = default;
+
+			copy_counter& operator=(const copy_counter&) { copies++; return *this; }
+
+			copy_counter& operator=(copy_counter&&) = default;
+
+		};
+
+		std::atomic<int> copy_counter::copies(0);
+
+	}
+
+	TEST(Future, NoCopies) {
+
+		// results are moved from the producing task to the consumer
+		for(int n : { 0, 2 }) {
+			runtime::PoolConfig config;
+			config.num_workers = n;
+			runtime::WorkerPool pool(config);
+
+			copy_counter::copies = 0;
+			auto f = runtime::spawn(pool, []() { return copy_counter(); });
+			copy_counter res = f.extract();
+			(void)res;
+
+			runtime::Promise<copy_counter> p;
+			auto g = p.getFuture();
+			p.forward(runtime::spawn(pool, []() { return copy_counter(); }));
+			res = g.extract();
+
+			EXPECT_EQ(0, copy_counter::copies) << "Workers: " << n;
+		}
+
+	}
+
+	TEST(RuntimeBenchmark, SpawnGetLatency) {
+
+		const int N = 1000000;
+
+		// measure the latency of spawning a task and waiting for its result within a task
+		auto res = runtime::spawn([N]()->double {
+			auto begin = std::chrono::steady_clock::now();
+			long sum = 0;
+			for(int i=0; i<N; i++) {
+				sum += runtime::spawn([i]() { return i; }).get();
+			}
+			auto end = std::chrono::steady_clock::now();
+			EXPECT_EQ(long(N)*(N-1)/2, sum);
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() / double(N);
+		}).get();
+
+		std::cout << "Spawn+get latency: " << res << "ns\n";
+
+	}
+
+	namespace {
+
+		void split(int a, int b, std::vector<int>& data) {
+			if (b - a <= 16) {
+				for(int i=a; i<b; i++) data[i]++;
+				return;
+			}
+			int m = a + (b - a) / 2;
+			auto l = runtime::spawn([a,m,&data]() { split(a,m,data); });
+			split(m,b,data);
+			l.get();
+		}
+
+	}
+
+	TEST(RuntimeBenchmark, WideLoopStartup) {
+
+		const int N = 1 << 16;
+		const int R = 100;
+		std::vector<int> data(N,0);
+
+		// measure the time of short, wide parallel loops dominated by their startup
+		auto begin = std::chrono::steady_clock::now();
+		for(int r=0; r<R; r++) {
+			runtime::spawn([&]() { split(0,N,data); }).get();
+		}
+		auto end = std::chrono::steady_clock::now();
+
+		for(const auto& cur : data) EXPECT_EQ(R, cur);
+
+		std::cout << "Wide loop time: " << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() / double(R) << "us\n";
+
+	}
+
+	TEST(RuntimeBenchmark, StealThroughput) {
+
+		const int N = 1000000;
+		const int T = 3;
+
+		runtime::WorkStealingDeque<int*> queue;
+		std::vector<int> data(N);
+		std::atomic<int> stolen(0);
+		std::atomic<bool> done(false);
+
+		// let some thieves hammer the queue while its owner is pushing and popping
+		auto begin = std::chrono::steady_clock::now();
+		std::vector<std::thread> thieves;
+		for(int i=0; i<T; i++) {
+			thieves.emplace_back([&]() {
+				int count = 0;
+				while(!done || !queue.empty()) {
+					if (queue.steal()) count++;
+				}
+				stolen += count;
+			});
+		}
+
+		int popped = 0;
+		for(int i=0; i<N; i++) {
+			queue.push_back(&data[i]);
+			if (i % 2 == 0 && queue.pop_back()) popped++;
+		}
+		done = true;
+		for(auto& cur : thieves) cur.join();
+		auto end = std::chrono::steady_clock::now();
+
+		EXPECT_EQ(N, popped + stolen);
+
+		auto time = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+		std::cout << "Steal throughput: " << stolen / (time / 1000.0) << " tasks/ms, " << stolen << " of " << N << " stolen\n";
+
+	}
+
+	TEST(WorkStealingDeque, Basic) {
+
+		runtime::WorkStealingDeque<int*> queue;
+
+		int x = 12;
 
-		// pop in the back
-		EXPECT_FALSE(queue.empty());
-		EXPECT_TRUE(queue.full());
-		EXPECT_EQ(1,queue.pop_back());
-		EXPECT_FALSE(queue.empty());
-		EXPECT_FALSE(queue.full());
-		EXPECT_EQ(2,queue.pop_back());
-		EXPECT_FALSE(queue.empty());
-		EXPECT_FALSE(queue.full());
-		EXPECT_EQ(3,queue.pop_back());
 		EXPECT_TRUE(queue.empty());
-		EXPECT_FALSE(queue.full());
-
-		// fill queue in the front again
-		EXPECT_FALSE(queue.full());
-		EXPECT_TRUE(queue.push_front(1)) << queue;
-		EXPECT_FALSE(queue.full());
-		EXPECT_TRUE(queue.push_front(2)) << queue;
-		EXPECT_FALSE(queue.full());
-		EXPECT_TRUE(queue.push_front(3)) << queue;
-		EXPECT_TRUE(queue.full());
-		EXPECT_FALSE(queue.push_front(4)) << queue;
-		EXPECT_TRUE(queue.full());
-
-		// pop in the front
-		EXPECT_FALSE(queue.empty());
-		EXPECT_TRUE(queue.full());
-		EXPECT_EQ(3,queue.pop_front());
-		EXPECT_FALSE(queue.empty());
-		EXPECT_FALSE(queue.full());
-		EXPECT_EQ(2,queue.pop_front());
+		EXPECT_EQ(nullptr, queue.pop_back());
+		EXPECT_EQ(nullptr, queue.steal());
+
+		queue.push_back(&x);
 		EXPECT_FALSE(queue.empty());
-		EXPECT_FALSE(queue.full());
-		EXPECT_EQ(1,queue.pop_front());
+		EXPECT_EQ(1, queue.size());
+		EXPECT_EQ(&x, queue.pop_back());
 		EXPECT_TRUE(queue.empty());
-		EXPECT_FALSE(queue.full());
-
-		// fill queue in the back
-		EXPECT_FALSE(queue.full());
-		EXPECT_TRUE(queue.push_back(1)) << queue;
-		EXPECT_FALSE(queue.full());
-		EXPECT_TRUE(queue.push_back(2)) << queue;
-		EXPECT_FALSE(queue.full());
-		EXPECT_TRUE(queue.push_back(3)) << queue;
-		EXPECT_TRUE(queue.full());
-		EXPECT_FALSE(queue.push_back(4)) << queue;
-		EXPECT_TRUE(queue.full());
-
-		// pop in the front
-		EXPECT_FALSE(queue.empty());
-		EXPECT_TRUE(queue.full());
-		EXPECT_EQ(1,queue.pop_front());
-		EXPECT_FALSE(queue.empty());
-		EXPECT_FALSE(queue.full());
-		EXPECT_EQ(2,queue.pop_front());
-		EXPECT_FALSE(queue.empty());
-		EXPECT_FALSE(queue.full());
-		EXPECT_EQ(3,queue.pop_front());
+
+		queue.push_back(&x);
+		EXPECT_EQ(&x, queue.steal());
 		EXPECT_TRUE(queue.empty());
-		EXPECT_FALSE(queue.full());
-
-		// fill queue in the back again
-		EXPECT_FALSE(queue.full());
-		EXPECT_TRUE(queue.push_back(1)) << queue;
-		EXPECT_FALSE(queue.full());
-		EXPECT_TRUE(queue.push_back(2)) << queue;
-		EXPECT_FALSE(queue.full());
-		EXPECT_TRUE(queue.push_back(3)) << queue;
-		EXPECT_TRUE(queue.full());
-		EXPECT_FALSE(queue.push_back(4)) << queue;
-		EXPECT_TRUE(queue.full());
-
-		// pop in the back
-		EXPECT_FALSE(queue.empty());
-		EXPECT_TRUE(queue.full());
-		EXPECT_EQ(3,queue.pop_back());
-		EXPECT_FALSE(queue.empty());
-		EXPECT_FALSE(queue.full());
-		EXPECT_EQ(2,queue.pop_back());
+
+	}
+
+	TEST(WorkStealingDeque, Order) {
+
+		runtime::WorkStealingDeque<int*> queue;
+
+		int data[] = { 1, 2, 3, 4 };
+		for(auto& cur : data) queue.push_back(&cur);
+
+		// the owner gets the newest element, thieves the oldest
+		EXPECT_EQ(4, *queue.pop_back());
+		EXPECT_EQ(1, *queue.steal());
+		EXPECT_EQ(3, *queue.pop_back());
+		EXPECT_EQ(2, *queue.steal());
+		EXPECT_TRUE(queue.empty());
+		EXPECT_EQ(nullptr, queue.pop_back());
+		EXPECT_EQ(nullptr, queue.steal());
+
+	}
+
+	TEST(WorkStealingDeque, Growth) {
+
+		runtime::WorkStealingDeque<int*> queue(4);
+		EXPECT_EQ(4, queue.capacity());
+
+		int N = 100;
+		std::vector<int> data(N);
+		for(int i=0; i<N; i++) {
+			data[i] = i;
+			queue.push_back(&data[i]);
+		}
+
+		EXPECT_EQ(N, queue.size());
+		EXPECT_LE(N, queue.capacity());
+
+		for(int i=0; i<N/2; i++) {
+			EXPECT_EQ(i, *queue.steal());
+		}
+		for(int i=N-1; i>=N/2; i--) {
+			EXPECT_EQ(i, *queue.pop_back());
+		}
+		EXPECT_TRUE(queue.empty());
+
+	}
+
+	TEST(WorkStealingDeque, Concurrent) {
+
+		runtime::WorkStealingDeque<int*> queue(2);
+
+		int N = 100000;
+		std::vector<int> data(N);
+		std::vector<std::atomic<int>> taken(N);
+		for(auto& cur : taken) cur = 0;
+
+		std::atomic<bool> done(false);
+
+		// start some thieves
+		std::vector<std::thread> thieves;
+		for(int i=0; i<3; i++) {
+			thieves.emplace_back([&]() {
+				while(!done || !queue.empty()) {
+					if (int* p = queue.steal()) taken[p - &data[0]]++;
+				}
+			});
+		}
+
+		// let the owner push and pop elements
+		for(int i=0; i<N; i++) {
+			queue.push_back(&data[i]);
+			if (i % 3 == 0) {
+				if (int* p = queue.pop_back()) taken[p - &data[0]]++;
+			}
+		}
+		while(int* p = queue.pop_back()) taken[p - &data[0]]++;
+
+		done = true;
+		for(auto& cur : thieves) cur.join();
+
+		// every element must have been obtained exactly once
+		for(int i=0; i<N; i++) {
+			EXPECT_EQ(1, taken[i]) << "Element " << i;
+		}
+
+	}
+
+	TEST(WorkStealingDeque, StealHalf) {
+
+		runtime::WorkStealingDeque<int*> victim;
+		runtime::WorkStealingDeque<int*> thief;
+
+		EXPECT_EQ(nullptr, victim.steal_half(thief, 4));
+
+		int data[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+		for(auto& cur : data) victim.push_back(&cur);
+
+		// the oldest half, bounded by the limit, is taken
+		EXPECT_EQ(1, *victim.steal_half(thief, 4));
+		EXPECT_EQ(3, thief.size());
+		EXPECT_EQ(6, victim.size());
+		EXPECT_EQ(4, *thief.pop_back());
+		EXPECT_EQ(2, *thief.steal());
+
+		// without a limit, half of the elements are taken
+		EXPECT_EQ(5, *victim.steal_half(thief, 100));
+		EXPECT_EQ(3, thief.size());
+		EXPECT_EQ(3, victim.size());
+
+		// a single element is never split
+		EXPECT_EQ(8, *victim.steal_half(thief, 1));
+		EXPECT_EQ(3, thief.size());
+		EXPECT_EQ(2, victim.size());
+
+	}
+
+	TEST(WorkStealingDeque, StealHalfConcurrent) {
+
+		runtime::WorkStealingDeque<int*> queue(2);
+
+		int N = 100000;
+		std::vector<int> data(N);
+		std::vector<std::atomic<int>> taken(N);
+		for(auto& cur : taken) cur = 0;
+
+		std::atomic<bool> done(false);
+
+		// start some thieves moving elements to their own deques
+		std::vector<std::thread> thieves;
+		for(int i=0; i<3; i++) {
+			thieves.emplace_back([&]() {
+				runtime::WorkStealingDeque<int*> local;
+				while(!done || !queue.empty()) {
+					if (int* p = queue.steal_half(local, 4)) taken[p - &data[0]]++;
+					while(int* p = local.pop_back()) taken[p - &data[0]]++;
+				}
+			});
+		}
+
+		// let the owner push and pop elements
+		for(int i=0; i<N; i++) {
+			queue.push_back(&data[i]);
+			if (i % 3 == 0) {
+				if (int* p = queue.pop_back()) taken[p - &data[0]]++;
+			}
+		}
+		while(int* p = queue.pop_back()) taken[p - &data[0]]++;
+
+		done = true;
+		for(auto& cur : thieves) cur.join();
+
+		// every element must have been obtained exactly once
+		for(int i=0; i<N; i++) {
+			EXPECT_EQ(1, taken[i]) << "Element " << i;
+		}
+
+	}
+
+	TEST(MPMCQueue, Basic) {
+
+		runtime::MPMCQueue<int*,4> queue;
+		EXPECT_TRUE(queue.empty());
+		EXPECT_EQ(nullptr, queue.pop_front());
+
+		int data[5];
+		for(int i=0; i<4; i++) {
+			EXPECT_TRUE(queue.push_back(&data[i]));
+		}
 		EXPECT_FALSE(queue.empty());
-		EXPECT_FALSE(queue.full());
-		EXPECT_EQ(1,queue.pop_back());
+
+		// the queue is bounded
+		EXPECT_FALSE(queue.push_back(&data[4]));
+
+		// elements are obtained in FIFO order
+		EXPECT_EQ(&data[0], queue.pop_front());
+		EXPECT_TRUE(queue.push_back(&data[4]));
+		for(int i=1; i<5; i++) {
+			EXPECT_EQ(&data[i], queue.pop_front());
+		}
+
 		EXPECT_TRUE(queue.empty());
-		EXPECT_FALSE(queue.full());
+		EXPECT_EQ(nullptr, queue.pop_front());
+
+	}
+
+	TEST(MPMCQueue, Concurrent) {
+
+		runtime::MPMCQueue<int*,64> queue;
+
+		int N = 100000;
+		std::vector<int> data(N);
+		std::vector<std::atomic<int>> taken(N);
+		for(auto& cur : taken) cur = 0;
+
+		std::atomic<int> producing(2);
+
+		// let some consumers take elements
+		std::vector<std::thread> threads;
+		for(int i=0; i<2; i++) {
+			threads.emplace_back([&]() {
+				while(producing > 0 || !queue.empty()) {
+					if (int* p = queue.pop_front()) taken[p - &data[0]]++;
+				}
+			});
+		}
+
+		// and some producers insert them
+		for(int i=0; i<2; i++) {
+			threads.emplace_back([&,i]() {
+				for(int j=i; j<N; j+=2) {
+					while(!queue.push_back(&data[j])) std::this_thread::yield();
+				}
+				producing--;
+			});
+		}
+
+		for(auto& cur : threads) cur.join();
+
+		// every element must have been obtained exactly once
+		for(int i=0; i<N; i++) {
+			EXPECT_EQ(1, taken[i]) << "Element " << i;
+		}
+
+	}
+
+	TEST(Task, InlineStorage) {
+
+		int x = 0;
+		auto small = [&]() { x++; };
+		EXPECT_TRUE(runtime::Task::isInline<decltype(small)>());
+
+		runtime::Task t(small);
+		EXPECT_FALSE(t.empty());
+		t();
+		EXPECT_TRUE(t.empty());
+		EXPECT_EQ(1, x);
+
+	}
+
+	TEST(Task, BoxedStorage) {
+
+		int x = 0;
+		std::array<int,64> data;
+		data.fill(1);
+		auto big = [&x,data]() { for(auto cur : data) x += cur; };
+		EXPECT_FALSE(runtime::Task::isInline<decltype(big)>());
+
+		runtime::Task t(big);
+		t();
+		EXPECT_TRUE(t.empty());
+		EXPECT_EQ(64, x);
+
+	}
+
+	TEST(Task, Discard) {
+
+		// closures are destroyed without being run
+		auto ptr = std::make_shared<int>(0);
+		{
+			runtime::Task t([ptr]() { (*ptr)++; });
+			EXPECT_EQ(2, ptr.use_count());
+			t.discard();
+			EXPECT_EQ(1, ptr.use_count());
+		}
+		{
+			runtime::Task t([ptr]() { (*ptr)++; });
+			EXPECT_EQ(2, ptr.use_count());
+		}
+		EXPECT_EQ(1, ptr.use_count());
+		EXPECT_EQ(0, *ptr);
+
+	}
+
+	TEST(TaskFramePool, Recycling) {
+
+		runtime::TaskFramePool pool;
+		EXPECT_EQ(0, pool.getSize());
+
+		int x = 0;
+		runtime::Task* a = pool.create([&]() { x++; });
+		(*a)();
+		pool.release(a);
+		EXPECT_EQ(1, pool.getSize());
+
+		// the released frame is reused
+		runtime::Task* b = pool.create([&]() { x++; });
+		EXPECT_EQ(a, b);
+		EXPECT_EQ(0, pool.getSize());
+		(*b)();
+		pool.release(b);
+
+		EXPECT_EQ(2, x);
+
+	}
+
+	TEST(ObjectPool, Recycling) {
+
+		runtime::ObjectPool pool;
+		EXPECT_EQ(0, pool.getSize(24));
+
+		void* a = pool.allocate(24);
+		pool.deallocate(a, 24);
+		EXPECT_EQ(1, pool.getSize(24));
+
+		// blocks are shared within a size class
+		EXPECT_EQ(1, pool.getSize(32));
+		EXPECT_EQ(0, pool.getSize(48));
+		void* b = pool.allocate(32);
+		EXPECT_EQ(a, b);
+		EXPECT_EQ(0, pool.getSize(24));
+		pool.deallocate(b, 32);
+
+		// big objects are not retained
+		void* c = pool.allocate(2 * runtime::ObjectPool::max_object_size);
+		pool.deallocate(c, 2 * runtime::ObjectPool::max_object_size);
+		EXPECT_EQ(0, pool.getSize(2 * runtime::ObjectPool::max_object_size));
+
+	}
+
+	TEST(Runtime, CrossThreadResults) {
+
+		// results produced by thieves have to be visible to the waiting thread
+		std::vector<runtime::Future<std::vector<int>>> list;
+		for(int i=0; i<100; i++) {
+			list.push_back(runtime::spawn([i]() { return std::vector<int>(i, i); }));
+		}
+		for(int i=0; i<100; i++) {
+			const auto& res = list[i].get();
+			EXPECT_EQ(std::size_t(i), res.size());
+			for(auto cur : res) EXPECT_EQ(i, cur);
+		}
+
+	}
+
+	TEST(EventCount, NoWaiters) {
+
+		runtime::EventCount events;
+		EXPECT_EQ(0, events.getNumWaiters());
+
+		// notifications without waiters are not blocking
+		events.notifyOne();
+		events.notifyAll();
+
+		// a canceled wait
+		events.prepareWait();
+		EXPECT_EQ(1, events.getNumWaiters());
+		events.cancelWait();
+		EXPECT_EQ(0, events.getNumWaiters());
+
+	}
+
+	TEST(EventCount, WaitNotify) {
+
+		runtime::EventCount events;
+		std::atomic<bool> flag(false);
+
+		std::thread waiter([&]() {
+			while(true) {
+				auto key = events.prepareWait();
+				if (flag) {
+					events.cancelWait();
+					return;
+				}
+				events.commitWait(key);
+			}
+		});
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		flag = true;
+		events.notifyOne();
+		waiter.join();
+
+		EXPECT_EQ(0, events.getNumWaiters());
 
 	}
 
+	TEST(EventCount, WaitTimeout) {
+
+		runtime::EventCount events;
+
+		// without notification, the wait ends with the timeout
+		auto key = events.prepareWait();
+		EXPECT_FALSE(events.commitWait(key, std::chrono::milliseconds(1)));
+		EXPECT_EQ(0, events.getNumWaiters());
+
+		// a notification ends the wait before the timeout
+		std::atomic<bool> notified(false);
+		std::thread waiter([&]() {
+			auto key = events.prepareWait();
+			notified = events.commitWait(key, std::chrono::seconds(10));
+		});
+		while(events.getNumWaiters() == 0) std::this_thread::yield();
+		events.notifyOne();
+		waiter.join();
+		EXPECT_TRUE(notified);
+
+	}
+
+	TEST(Runtime, WakeUp) {
+
+		// let workers fall asleep between bursts of work
+		for(int i=0; i<10; i++) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+			std::atomic<int> c(0);
+			std::vector<runtime::Future<void>> list;
+			for(int j=0; j<10; j++) {
+				list.push_back(runtime::spawn([&]() { c++; }));
+			}
+			for(const auto& cur : list) cur.get();
+			EXPECT_EQ(10, c);
+		}
+
+	}
+
+	TEST(Runtime, IdlePolicies) {
+
+		runtime::IdlePolicy timeout;
+		timeout.spin_cycles = 100;
+		timeout.backoff = true;
+		timeout.max_backoff = 16;
+		timeout.yield_cycles = 10;
+		timeout.park_timeout = std::chrono::microseconds(100);
+
+		runtime::IdlePolicy yielding;
+		yielding.yield_cycles = 10;
+		yielding.park = false;
+
+		for(const auto& policy : { runtime::IdlePolicy::latency(), runtime::IdlePolicy::batch(), timeout, yielding }) {
+			runtime::PoolConfig config;
+			config.num_workers = 2;
+			config.idle = policy;
+			runtime::WorkerPool pool(config);
+
+			// let workers run out of work between bursts
+			for(int i=0; i<5; i++) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(2));
+				std::atomic<int> c(0);
+				std::vector<runtime::Future<void>> list;
+				for(int j=0; j<10; j++) {
+					list.push_back(runtime::spawn(pool, [&]() { c++; }));
+				}
+				for(const auto& cur : list) cur.get();
+				EXPECT_EQ(10, c);
+			}
+		}
+
+	}
+
+	TEST(Runtime, ExternalThreads) {
+
+		// spawn tasks from threads not being workers
+		std::atomic<int> c(0);
+		std::vector<std::thread> threads;
+		for(int i=0; i<4; i++) {
+			threads.emplace_back([&]() {
+				std::vector<runtime::Future<void>> list;
+				for(int j=0; j<100; j++) {
+					list.push_back(runtime::spawn([&]() { c++; }));
+				}
+				for(const auto& cur : list) cur.get();
+			});
+		}
+		for(auto& cur : threads) cur.join();
+
+		EXPECT_EQ(400, c);
+
+	}
+
+	TEST(Runtime, SpawnN) {
+
+		for(int n : { 0, 1, 4 }) {
+			runtime::PoolConfig config;
+			config.num_workers = n;
+			runtime::WorkerPool pool(config);
+
+			// a batch spawned by an external thread
+			std::vector<std::atomic<int>> hits(1000);
+			for(auto& cur : hits) cur = 0;
+			runtime::spawn_n(pool, hits.size(), [&](std::size_t i) { hits[i]++; }).get();
+			for(const auto& cur : hits) EXPECT_EQ(1, cur) << "Workers: " << n;
+
+			// nested batches spawned by workers
+			std::atomic<int> c(0);
+			runtime::spawn(pool, [&]() {
+				runtime::spawn_n(10, [&](std::size_t) {
+					runtime::spawn_n(100, [&](std::size_t) { c++; }).get();
+				}).get();
+			}).get();
+			EXPECT_EQ(1000, c) << "Workers: " << n;
+
+			// empty batches are ready immediately
+			EXPECT_TRUE(runtime::spawn_n(pool, 0, [](std::size_t) {}).isDone());
+
+			// the first failure is reported through the join handle
+			auto fail = []() {
+				runtime::spawn_n(100, [](std::size_t i) {
+					if (i == 50) throw std::runtime_error("failed");
+				}).get();
+			};
+			EXPECT_THROW(runtime::spawn(pool, fail).get(), std::runtime_error);
+		}
+
+	}
+
+	namespace {
+
+		int fib(int n) {
+			if (n < 2) return n;
+			int a = 0, b = 0;
+			runtime::TaskGroup group;
+			group.run([&]() { a = fib(n-1); });
+			group.runAndWait([&]() { b = fib(n-2); });
+			return a + b;
+		}
+
+	}
+
+	TEST(TaskGroup, Basic) {
+
+		for(int n : { 0, 1, 4 }) {
+			runtime::PoolConfig config;
+			config.num_workers = n;
+			runtime::WorkerPool pool(config);
+
+			// operations run by an external thread
+			std::atomic<int> c(0);
+			{
+				runtime::TaskGroup group(pool);
+				for(int i=0; i<100; i++) group.run([&]() { c++; });
+				group.wait();
+				EXPECT_EQ(100, c) << "Workers: " << n;
+			}
+
+			// recursively nested groups
+			EXPECT_EQ(610, runtime::spawn(pool, []() { return fib(15); }).get()) << "Workers: " << n;
+
+			// the first failure is rethrown by wait
+			auto fail = []() {
+				runtime::TaskGroup group;
+				group.run([]() {});
+				group.run([]() { throw std::runtime_error("failed"); });
+				group.wait();
+			};
+			EXPECT_THROW(runtime::spawn(pool, fail).get(), std::runtime_error);
+		}
+
+	}
+
+	TEST(TaskGroup, SubtreeOnly) {
+
+		runtime::PoolConfig config;
+		config.num_workers = 1;
+		runtime::WorkerPool pool(config);
+
+		// a waiting worker does not process tasks queued before the group
+		auto f = runtime::spawn(pool, []() {
+			std::atomic<bool> other(false);
+			auto g = runtime::spawn([&]() { other = true; });
+			bool before = false;
+			runtime::TaskGroup group;
+			group.run([&]() { before = other; });
+			group.wait();
+			g.get();
+			return !before && other;
+		});
+		EXPECT_TRUE(f.get());
+
+	}
+
+	TEST(TaskGroup, Waiters) {
+
+		runtime::PoolConfig config;
+		config.num_workers = 1;
+		runtime::WorkerPool pool(config);
+
+		// external threads sleep until the last operation is done, groups may be reused
+		std::atomic<int> c(0);
+		runtime::TaskGroup group(pool);
+		for(int i=0; i<20; i++) {
+			for(int j=0; j<4; j++) {
+				group.run([&]() {
+					std::this_thread::sleep_for(std::chrono::microseconds(100));
+					c++;
+				});
+			}
+			group.wait();
+			EXPECT_EQ(4*(i+1), c);
+		}
+
+		// workers not owning the group process its operations while waiting
+		runtime::TaskGroup other(pool);
+		std::atomic<bool> blocked(true);
+		auto f = runtime::spawn(pool, [&]() {
+			while(blocked) {}
+			other.wait();
+			return int(c);
+		});
+		for(int i=0; i<10; i++) other.run([&]() { c++; });
+		blocked = false;
+		EXPECT_EQ(90, f.get());
+
+		// the owner sleeps while operations taken by other workers are processed
+		runtime::PoolConfig sleepy;
+		sleepy.num_workers = 2;
+		sleepy.idle.spin_cycles = 0;
+		runtime::WorkerPool other_pool(sleepy);
+		auto g = runtime::spawn(other_pool, []() {
+			std::atomic<bool> stolen(false);
+			runtime::TaskGroup group;
+			group.run([&]() {
+				stolen = true;
+				std::this_thread::sleep_for(std::chrono::milliseconds(5));
+			});
+			while(!stolen) {}
+			group.wait();
+			return true;
+		});
+		EXPECT_TRUE(g.get());
+
+	}
+
+	TEST(Runtime, NestingLimit) {
+
+		runtime::PoolConfig config;
+		config.num_workers = 1;
+		config.max_nesting = 2;
+		runtime::WorkerPool pool(config);
+
+		// beyond the limit, spawned operations are processed directly
+		std::function<int(int)> sum = [&](int x) {
+			return (x == 0) ? 0 : runtime::spawn([&,x]() { return sum(x-1); }).get() + x;
+		};
+		EXPECT_EQ(5050, runtime::spawn(pool, [&]() { return sum(100); }).get());
+
+		// beyond the limit, waiting workers do not process tasks of enclosing operations
+		runtime::Promise<int> promise;
+		std::thread t([&]() {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			promise.set(1);
+		});
+		auto f = runtime::spawn(pool, [&]() {
+			std::atomic<bool> other(false);
+			runtime::WorkerPool::getCurrent().submit([&]() { other = true; });
+			auto g = runtime::spawn([&]() {
+				auto res = promise.getFuture();
+				res.get();
+				return bool(other);
+			});
+			bool interleaved = g.get();
+			while (!other) runtime::schedule_step();
+			return interleaved;
+		});
+		EXPECT_FALSE(f.get());
+		t.join();
+
+	}
+
+	TEST(Parker, ParkUnpark) {
+
+		runtime::Parker parker;
+
+		// a preceding signal is not lost
+		parker.unpark();
+		parker.park();
+
+		// a parked thread is released
+		std::atomic<bool> done(false);
+		std::thread t([&]() {
+			parker.park();
+			done = true;
+		});
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		EXPECT_FALSE(done);
+		parker.unpark();
+		t.join();
+		EXPECT_TRUE(done);
+
+	}
+
+	TEST(Future, ExternalBlockingWait) {
+
+		// a thread outside the pool blocks until the value is set
+		runtime::Promise<int> promise;
+		auto future = promise.getFuture();
+		std::thread t([&]() {
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+			promise.set(12);
+		});
+		EXPECT_EQ(12, future.get());
+		t.join();
+
+	}
+
+	TEST(Future, ExternalWaiterExit) {
+
+		// waiting threads may be gone before the completing thread wakes them up
+		for(int i=0; i<200; i++) {
+			runtime::Promise<int> promise;
+			auto future = promise.getFuture();
+			std::atomic<bool> waiting(false);
+			std::thread t([&]() {
+				waiting = true;
+				EXPECT_EQ(i, future.get());
+			});
+			while(!waiting) {}
+			for(int j=0; j<i*10; j++) cpu_relax();
+			promise.set(i);
+			t.join();
+		}
+
+	}
+
+	TEST(Runtime, ExternalSubmitters) {
+
+		runtime::PoolConfig config;
+		config.num_workers = 2;
+		runtime::WorkerPool pool(config);
+
+		// many external threads submitting concurrently, exceeding the injection queue
+		std::atomic<int> c(0);
+		std::vector<std::thread> threads;
+		for(int i=0; i<8; i++) {
+			threads.emplace_back([&]() {
+				std::vector<runtime::Future<int>> list;
+				for(int j=0; j<500; j++) {
+					list.push_back(runtime::spawn(pool, [&]() { c++; return 1; }));
+				}
+				int sum = 0;
+				for(const auto& cur : list) sum += cur.get();
+				EXPECT_EQ(500, sum);
+			});
+		}
+		for(auto& cur : threads) cur.join();
+
+		EXPECT_EQ(4000, c);
+
+	}
 
 } // end namespace util
 } // end namespace parec
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#define PAREC_ENABLE_STATISTICS
+
+#include <sstream>
+#include <vector>
+
+#include "parec/utils/runtime/runtime.h"
+
+namespace parec {
+namespace utils {
+
+	TEST(Statistics, Counters) {
+
+		runtime::PoolConfig config;
+		config.num_workers = 2;
+		runtime::WorkerPool pool(config);
+
+		auto stats = pool.getStatistics();
+		EXPECT_EQ(2, stats.workers.size());
+		EXPECT_EQ(0, stats.getTotal().tasks_executed);
+
+		// spawn some tasks from outside and inside the pool
+		std::vector<runtime::Future<int>> futures;
+		for(int i=0; i<10; i++) {
+			futures.push_back(runtime::spawn(pool, [i]() {
+				return runtime::spawn([i]() { return i; }).get();
+			}));
+		}
+		int sum = 0;
+		for(auto& cur : futures) sum += cur.get();
+		EXPECT_EQ(45, sum);
+
+		stats = pool.getStatistics();
+		auto total = stats.getTotal();
+		EXPECT_EQ(10, stats.external.tasks_spawned);
+		EXPECT_EQ(20, total.tasks_spawned + total.inline_fallbacks);
+		EXPECT_EQ(total.tasks_spawned, total.tasks_executed);
+		EXPECT_LE(total.steal_successes, total.steal_attempts);
+
+		std::stringstream out;
+		out << stats;
+		EXPECT_NE(std::string::npos, out.str().find("Total"));
+
+		// the idle policy is reported
+		EXPECT_EQ(config.idle.spin_cycles, stats.idle.spin_cycles);
+		EXPECT_NE(std::string::npos, out.str().find("Idle policy: spin 1000"));
+
+		// reset the statistics
+		pool.resetStatistics();
+		total = pool.getStatistics().getTotal();
+		EXPECT_EQ(0, total.tasks_spawned);
+		EXPECT_EQ(0, total.tasks_executed);
+
+	}
+
+	TEST(Statistics, IdleTime) {
+
+		runtime::PoolConfig config;
+		config.num_workers = 1;
+		runtime::WorkerPool pool(config);
+
+		// let the worker run out of work
+		runtime::spawn(pool, []() {}).get();
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		runtime::spawn(pool, []() {}).get();
+
+		auto stats = pool.getStatistics();
+		EXPECT_LT(0, stats.workers[0].spin_time + stats.workers[0].park_time);
+
+	}
+
+} // end namespace utils
+} // end namespace parec
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "parec/utils/runtime/topology.h"
+
+namespace parec {
+namespace utils {
+
+	using namespace runtime;
+
+	namespace {
+
+		void writeFile(const std::string& dir, const std::string& file, const std::string& content) {
+			// create the directory path
+			for(std::size_t pos = dir.find('/', 1); ; pos = dir.find('/', pos+1)) {
+				mkdir(dir.substr(0,pos).c_str(), 0755);
+				if (pos == std::string::npos) break;
+			}
+			std::ofstream(dir + "/" + file) << content << "\n";
+		}
+
+		/**
+		 * Creates a sysfs tree of a machine with two packages of two cores, each running
+		 * two hardware threads, with a shared L3 cache and a NUMA node per package.
+		 */
+		std::string createDualSocketMachine() {
+			char tmp[] = "/tmp/parec_topologyXXXXXX";
+			std::string root = mkdtemp(tmp);
+			for(int cpu=0; cpu<8; cpu++) {
+				std::string dir = root + "/cpu/cpu" + std::to_string(cpu);
+				int package = (cpu / 2) % 2;
+				writeFile(dir + "/topology", "core_id", std::to_string(cpu % 2));
+				writeFile(dir + "/topology", "physical_package_id", std::to_string(package));
+				writeFile(dir + "/cache/index0", "level", "1");
+				writeFile(dir + "/cache/index0", "shared_cpu_list", std::to_string(cpu));
+				writeFile(dir + "/cache/index1", "level", "3");
+				writeFile(dir + "/cache/index1", "shared_cpu_list", (package == 0) ? "0-1,4-5" : "2-3,6-7");
+			}
+			writeFile(root + "/node/node0", "cpulist", "0-1,4-5");
+			writeFile(root + "/node/node1", "cpulist", "2-3,6-7");
+			return root;
+		}
+
+		/**
+		 * Creates a sysfs tree of a machine with two packages of four cores, pairs of cores
+		 * sharing an L3 cache, without any NUMA information.
+		 */
+		std::string createSplitCacheMachine() {
+			char tmp[] = "/tmp/parec_topologyXXXXXX";
+			std::string root = mkdtemp(tmp);
+			for(int cpu=0; cpu<8; cpu++) {
+				std::string dir = root + "/cpu/cpu" + std::to_string(cpu);
+				int first = cpu - cpu % 2;
+				writeFile(dir + "/topology", "core_id", std::to_string(cpu % 4));
+				writeFile(dir + "/topology", "physical_package_id", std::to_string(cpu / 4));
+				writeFile(dir + "/cache/index0", "level", "3");
+				writeFile(dir + "/cache/index0", "shared_cpu_list", std::to_string(first) + "-" + std::to_string(first + 1));
+			}
+			return root;
+		}
+
+	}
+
+	TEST(Topology, ParseCpuList) {
+		EXPECT_EQ(std::vector<int>(), Topology::parseCpuList(""));
+		EXPECT_EQ(std::vector<int>({3}), Topology::parseCpuList("3"));
+		EXPECT_EQ(std::vector<int>({0,1,2,3,8,10,11}), Topology::parseCpuList("0-3,8,10-11"));
+	}
+
+	TEST(Topology, DualSocket) {
+
+		auto root = createDualSocketMachine();
+		auto topology = Topology::read(root, {0,1,2,3,4,5,6,7});
+		std::system(("rm -rf " + root).c_str());
+
+		const auto& cpus = topology.getCpus();
+		ASSERT_EQ(8, cpus.size());
+
+		EXPECT_EQ(Topology::SameCpu, Topology::getDistance(cpus[0], cpus[0]));
+		EXPECT_EQ(Topology::SameCore, Topology::getDistance(cpus[0], cpus[4]));
+		EXPECT_EQ(Topology::SameCache, Topology::getDistance(cpus[0], cpus[1]));
+		EXPECT_EQ(Topology::SameCache, Topology::getDistance(cpus[0], cpus[5]));
+		EXPECT_EQ(Topology::Remote, Topology::getDistance(cpus[0], cpus[2]));
+		EXPECT_EQ(Topology::Remote, Topology::getDistance(cpus[4], cpus[7]));
+
+		// physical cores are occupied first, packages are filled one after another
+		std::vector<int> order;
+		for(const auto& cur : topology.getPlacement()) order.push_back(cur.id);
+		EXPECT_EQ(std::vector<int>({0,1,2,3,4,5,6,7}), order);
+
+	}
+
+	TEST(Topology, Fallback) {
+
+		auto topology = Topology::read("/does/not/exist", {0,1,2});
+
+		const auto& cpus = topology.getCpus();
+		ASSERT_EQ(3, cpus.size());
+
+		// each CPU is a core of its own, all sharing a package
+		EXPECT_EQ(Topology::SameCache, Topology::getDistance(cpus[0], cpus[1]));
+		EXPECT_EQ(Topology::SameCache, Topology::getDistance(cpus[1], cpus[2]));
+
+	}
+
+	TEST(Topology, NoNuma) {
+
+		auto root = createSplitCacheMachine();
+		auto topology = Topology::read(root, {0,1,2,3,4,5,6,7});
+		std::system(("rm -rf " + root).c_str());
+
+		const auto& cpus = topology.getCpus();
+		ASSERT_EQ(8, cpus.size());
+
+		// all CPUs share the default node, still other packages are the furthest
+		EXPECT_EQ(Topology::SameCache, Topology::getDistance(cpus[0], cpus[1]));
+		EXPECT_EQ(Topology::SameNode, Topology::getDistance(cpus[0], cpus[2]));
+		EXPECT_EQ(Topology::Remote, Topology::getDistance(cpus[0], cpus[4]));
+		EXPECT_EQ(Topology::Remote, Topology::getDistance(cpus[3], cpus[6]));
+
+	}
+
+	TEST(Topology, Detect) {
+
+		auto topology = Topology::detect();
+		EXPECT_LE(1, topology.getCpus().size());
+		EXPECT_EQ(topology.getCpus().size(), topology.getPlacement().size());
+
+	}
+
+} // end namespace utils
+} // end namespace parec
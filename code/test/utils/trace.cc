@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+
+#define PAREC_ENABLE_TRACING
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+
+#include "parec/core.h"
+#include "parec/ops.h"
+
+namespace parec {
+namespace utils {
+
+	TEST(Trace, Buffer) {
+
+		runtime::TraceBuffer buffer;
+
+		int count = 0;
+		buffer.forEach([&](const runtime::TraceEvent&) { count++; });
+		EXPECT_EQ(0, count);
+
+		runtime::TraceLabel label("test");
+		buffer.record(runtime::TraceEventType::TaskBegin, runtime::TraceLabel::get());
+		buffer.record(runtime::TraceEventType::TaskEnd, runtime::TraceLabel::get());
+
+		std::stringstream out;
+		bool first = true;
+		runtime::writeTraceEvents(out, 3, buffer, first);
+		EXPECT_EQ(std::string::npos, out.str().find("task"));
+		EXPECT_NE(std::string::npos, out.str().find("\"name\":\"test\",\"ph\":\"B\""));
+		EXPECT_NE(std::string::npos, out.str().find("\"name\":\"test\",\"ph\":\"E\""));
+		EXPECT_NE(std::string::npos, out.str().find("\"tid\":3"));
+
+		// old events are overwritten once the buffer is full
+		for(int i=0; i<1000000; i++) {
+			buffer.record(runtime::TraceEventType::Spawn, nullptr);
+		}
+		count = 0;
+		buffer.forEach([&](const runtime::TraceEvent& e) {
+			EXPECT_EQ(runtime::TraceEventType::Spawn, e.type);
+			count++;
+		});
+		EXPECT_LT(0, count);
+		EXPECT_GT(1000000, count);
+
+		buffer.clear();
+		count = 0;
+		buffer.forEach([&](const runtime::TraceEvent&) { count++; });
+		EXPECT_EQ(0, count);
+
+	}
+
+	TEST(Trace, Escaping) {
+
+		runtime::TraceBuffer buffer;
+		buffer.record(runtime::TraceEventType::TaskBegin, "a \"quoted\" \\ label\n");
+
+		std::stringstream out;
+		bool first = true;
+		runtime::writeTraceEvents(out, 0, buffer, first);
+		EXPECT_NE(std::string::npos, out.str().find("\"name\":\"a \\\"quoted\\\" \\\\ label\\u000a\",")) << out.str();
+
+	}
+
+	TEST(Trace, Wrapping) {
+
+		// the begin events of the oldest tasks get overwritten ...
+		runtime::TraceBuffer buffer;
+		for(int i=0; i<100000; i++) {
+			buffer.record(runtime::TraceEventType::TaskBegin, nullptr);
+		}
+		for(int i=0; i<100000; i++) {
+			buffer.record(runtime::TraceEventType::TaskEnd, nullptr);
+		}
+
+		// ... thus their end events are dropped
+		buffer.record(runtime::TraceEventType::TaskBegin, "last");
+		buffer.record(runtime::TraceEventType::TaskEnd, "last");
+
+		std::stringstream out;
+		bool first = true;
+		runtime::writeTraceEvents(out, 0, buffer, first);
+		std::string trace = out.str();
+		EXPECT_EQ(0u, trace.find("{\"name\":\"last\",\"ph\":\"B\""));
+		EXPECT_EQ(1, std::count(trace.begin(), trace.end(), '\n'));
+		EXPECT_NE(std::string::npos, trace.find("\"name\":\"last\",\"ph\":\"E\""));
+
+	}
+
+	TEST(Trace, Labels) {
+
+		runtime::PoolConfig config;
+		config.num_workers = 2;
+		runtime::WorkerPool pool(config);
+		runtime::WorkerPool::Scope scope(pool);
+
+		auto fib = label("fib", prec(
+			[](int x) { return x < 2; },
+			[](int x) { return x; },
+			[](int x, const auto& f) {
+				auto a = f(x-1);
+				auto b = f(x-2);
+				return a.get() + b.get();
+			}
+		));
+		EXPECT_EQ(6765, fib(20).get());
+
+		std::vector<int> data(10000, 1);
+		pfor(data, [](int& x) { x++; });
+
+		std::stringstream out;
+		pool.writeTrace(out);
+		auto trace = out.str();
+		EXPECT_EQ(0, trace.find("{\"traceEvents\":["));
+		EXPECT_NE(std::string::npos, trace.find("\"name\":\"fib\",\"ph\":\"B\""));
+		EXPECT_NE(std::string::npos, trace.find("\"name\":\"pfor\",\"ph\":\"E\""));
+
+		pool.clearTrace();
+		out.str("");
+		pool.writeTrace(out);
+		EXPECT_EQ("{\"traceEvents\":[\n\n]}\n", out.str());
+
+	}
+
+} // end namespace utils
+} // end namespace parec